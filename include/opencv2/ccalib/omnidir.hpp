@@ -40,6 +40,7 @@
 //M*/
 
 #include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
 #include <vector>
 
 #ifndef __OPENCV_OMNIDIR_HPP__
@@ -61,7 +62,8 @@ namespace omnidir
         CALIB_FIX_P2                = 32,
         CALIB_FIX_XI                = 64,
         CALIB_FIX_GAMMA             = 128,
-        CALIB_FIX_CENTER            = 256
+        CALIB_FIX_CENTER            = 256,
+        CALIB_MIXED_PRECISION       = 512
     };
 
     enum{
@@ -98,10 +100,32 @@ namespace omnidir
     The function projects object 3D points of world coordinate to image pixels, parameter by intrinsic
     and extrinsic parameters. Also, it optionally compute a by-product: the jacobian matrix containing
     contains the derivatives of image pixel points wrt intrinsic and extrinsic parameters.
+
+    When the jacobian is not requested and the CPU supports 128-bit SIMD, points are projected four
+    at a time in double precision (float points are widened first). The results agree with the scalar
+    path to within 1e-10 relative error; float outputs differ at most by the final rounding to float.
      */
     CV_EXPORTS_W void projectPoints(InputArray objectPoints, OutputArray imagePoints, InputArray rvec, InputArray tvec,
                        InputArray K, double xi, InputArray D, OutputArray jacobian = noArray());
 
+    /** @brief Projects points under many poses of the same omnidirectional camera in one call
+
+    @param objectPoints Object points in world coordinate. Either one set of points (vector of Vec3f/Vec3d
+    or 1xN/Nx1 3-channel Mat) shared by all poses, or a vector of such sets, one per pose.
+    @param imagePoints Output 1xM 2-channel array with the depth of objectPoints. The projections of all
+    poses are concatenated in pose order. A preallocated array of the right size and type is written in place.
+    @param rvecs Rotation vectors of the poses, vector of Vec3f/Vec3d or vector of 3x1 Mat
+    @param tvecs Translation vectors of the poses, in the same format as rvecs
+    @param K Camera matrix \f$K = \vecthreethree{f_x}{s}{c_x}{0}{f_y}{c_y}{0}{0}{_1}\f$.
+    @param D Input vector of distortion coefficients \f$(k_1, k_2, p_1, p_2)\f$.
+    @param xi The parameter xi for CMei's model
+
+    The result is the same as calling projectPoints once per pose, but the intrinsics are parsed
+    once and the poses are projected in parallel.
+     */
+    CV_EXPORTS_W void projectPointsBatch(InputArrayOfArrays objectPoints, OutputArray imagePoints, InputArrayOfArrays rvecs,
+                       InputArrayOfArrays tvecs, InputArray K, double xi, InputArray D);
+
     /** @brief Undistort 2D image points for omnidirectional camera using CMei's model
 
     @param distorted Array of distorted image points, vector of Vec2f
@@ -116,6 +140,130 @@ namespace omnidir
      */
     CV_EXPORTS_W void undistortPoints(InputArray distorted, OutputArray undistorted, InputArray K, InputArray D, InputArray xi, InputArray R);
 
+    /** @overload
+
+    @param criteria Termination criteria of the Newton iterations that remove the distortion of each point. The
+    iterations of a point stop after criteria.maxCount steps, or 100 steps when criteria has no COUNT, or once a
+    step in the normalized plane is not longer than criteria.epsilon. With EPS, a point that has no such step,
+    because it does not converge or its distortion jacobian is singular, is undistorted to NaN. The overload
+    above uses TermCriteria(COUNT+EPS, 20, 1e-12).
+    @param iterations Optional output number of Newton steps taken for each point, of type CV_32S and the same
+    size as distorted.
+     */
+    CV_EXPORTS_W void undistortPoints(InputArray distorted, OutputArray undistorted, InputArray K, InputArray D, InputArray xi, InputArray R,
+        TermCriteria criteria, OutputArray iterations = noArray());
+
+    /** @overload
+
+    @param Dinv Closed form inverse of the distortion from fitInverseDistortion. Each point costs the closed form and
+    a fixed number of Newton steps instead of iterating to convergence.
+     */
+    CV_EXPORTS_W void undistortPoints(InputArray distorted, OutputArray undistorted, InputArray K, InputArray D, InputArray xi, InputArray R,
+        InputArray Dinv);
+
+    /** @brief Lifts 2D image points of an omnidirectional camera to unit bearing vectors using CMei's model
+
+    @param distorted Array of distorted image points, vector of Vec2f
+    or 1xN/Nx1 2-channel Mat of type CV_32F, 64F depth is also acceptable
+    @param sphere Output array of unit vectors, vector of Vec3f/Vec3d or 3-channel Mat with the same size and depth
+    as distorted.
+    @param K Camera matrix \f$K = \vecthreethree{f_x}{s}{c_x}{0}{f_y}{c_y}{0}{0}{_1}\f$.
+    @param D Distortion coefficients \f$(k_1, k_2, p_1, p_2)\f$.
+    @param xi The parameter xi for CMei's model
+    @param R Rotation trainsform between the original and object space : 3x3 1-channel, or vector: 3x1/1x3
+    1-channel or 1x1 3-channel
+    @param Dinv Optional closed form inverse of the distortion from fitInverseDistortion, see undistortPoints
+
+    The points are lifted to the unit sphere and rotated like in undistortPoints, but written as they are,
+    without the projection to the normalized plane. Unlike the plane, the bearings also represent points at
+    90 degrees or more from the optical axis, which wide angle omnidirectional cameras do see.
+     */
+    CV_EXPORTS_W void unprojectToSphere(InputArray distorted, OutputArray sphere, InputArray K, InputArray D, InputArray xi,
+        InputArray R = noArray(), InputArray Dinv = noArray());
+
+    /** @brief Fits a closed form inverse of the distortion of CMei's model over an image
+
+    @param K Camera matrix \f$K = \vecthreethree{f_x}{s}{c_x}{0}{f_y}{c_y}{0}{0}{_1}\f$.
+    @param D Distortion coefficients \f$(k_1, k_2, p_1, p_2)\f$.
+    @param xi The parameter xi for CMei's model
+    @param imageSize Size of the image whose points are fitted
+    @param Dinv Output 1x6 CV_64F inverse coefficients \f$(b_1, b_2, b_3, b_4, q_1, q_2)\f$
+
+    With \f$(x, y)\f$ a distorted point of the normalized plane and \f$r^2 = x^2 + y^2\f$, the inverse is
+    \f[x_u = x (1 + b_1 r^2 + b_2 r^4 + b_3 r^6 + b_4 r^8) + 2 q_1 x y + q_2 (r^2 + 2 x^2)\f]
+    \f[y_u = y (1 + b_1 r^2 + b_2 r^4 + b_3 r^6 + b_4 r^8) + q_1 (r^2 + 2 y^2) + 2 q_2 x y\f]
+    It is fitted by least squares to the exact inverse on a grid over the image, skipping the points that
+    do not lift to the sphere. A polynomial alone is off by pixels in the corners of wide fields of view, so
+    undistortPoints and unprojectToSphere follow it by two Newton steps, which is still a fixed cost per point.
+    Returns the largest reprojection error in pixels of the closed form and the two steps over the grid.
+     */
+    CV_EXPORTS_W double fitInverseDistortion(InputArray K, InputArray D, InputArray xi, const Size& imageSize, OutputArray Dinv);
+
+    /** @brief Lookup grid that replaces the per-point iterations of undistortPoints for one camera.
+
+    The unit sphere points of undistortPoints are sampled once on a regular grid of gridSize cells over the
+    image and queries are answered by bilinear (INTER_LINEAR) or Catmull-Rom bicubic (INTER_CUBIC) interpolation
+    between the grid nodes, followed by the rotation R and the projection to the normalized plane. The cost per
+    point is constant. Points outside the image are extrapolated from the border cells.
+
+    maxError() is the largest angle, in radians, between an interpolated and an exact bearing on a 4x4 sub-grid
+    of every cell. It is measured when the grid is built and is an estimate rather than a strict bound. For a
+    1280x800 fisheye image with f around 400 pixels the default 64x48 bicubic grid gives about 1.5e-4 rad, or
+    0.06 pixel, and a bilinear grid of the same size about three times as much.
+
+    For xi > 1 the model lifts only the pixels inside a disk, and undistortPoints gives NaN outside of it. Points
+    whose interpolation involves a node outside the disk are lifted exactly instead. maxError() is NaN when a
+    point the model cannot lift lies between nodes it can.
+     */
+    class CV_EXPORTS UndistortPointsLUT
+    {
+    public:
+        UndistortPointsLUT();
+
+        /** @brief Builds the grid, see create() */
+        UndistortPointsLUT(InputArray K, InputArray D, InputArray xi, const Size& imageSize,
+            const Size& gridSize = Size(64, 48), int interpolation = INTER_CUBIC);
+
+        /** @brief Builds the grid
+
+        @param K Camera matrix \f$K = \vecthreethree{f_x}{s}{c_x}{0}{f_y}{c_y}{0}{0}{_1}\f$.
+        @param D Distortion coefficients \f$(k_1, k_2, p_1, p_2)\f$.
+        @param xi The parameter xi for CMei's model
+        @param imageSize Size of the image the points come from
+        @param gridSize Number of grid cells in x and y direction
+        @param interpolation INTER_LINEAR or INTER_CUBIC
+         */
+        void create(InputArray K, InputArray D, InputArray xi, const Size& imageSize,
+            const Size& gridSize = Size(64, 48), int interpolation = INTER_CUBIC);
+
+        /** @brief Same as omnidir::undistortPoints, with the unit sphere points interpolated from the grid
+
+        @param distorted Array of distorted image points, vector of Vec2f/Vec2d or 1xN/Nx1 2-channel Mat
+        @param undistorted Array of normalized object points with the same size and type as distorted
+        @param R Rotation trainsform between the original and object space : 3x3 1-channel, or vector: 3x1/1x3
+        1-channel or 1x1 3-channel
+         */
+        void undistortPoints(InputArray distorted, OutputArray undistorted, InputArray R = noArray()) const;
+
+        //! Largest angular error of the interpolated bearings, in radians
+        double maxError() const { return _maxError; }
+
+        bool empty() const { return _grid.empty(); }
+
+    private:
+        bool interpolate(const Vec2d& pi, Vec3d& Xs) const;
+        Vec3d node(int x, int y) const;
+
+        Mat _grid;          // unit sphere points at the grid nodes, (gridSize.height+1)x(gridSize.width+1) CV_64FC3
+        Size _gridSize;
+        Vec2d _step;        // grid step in pixels
+        Matx33d _K;         // for the exact lift next to undefined nodes
+        Vec4d _D;
+        double _xi;
+        int _interpolation;
+        double _maxError;
+    };
+
     /** @brief Computes undistortion and rectification maps for omnidirectional camera image transform by a rotation R.
     It output two maps that are used for cv::remap(). If D is empty then zero distortion is used,
     if R or P is empty then identity matrices are used.
@@ -136,6 +284,157 @@ namespace omnidir
     CV_EXPORTS_W void initUndistortRectifyMap(InputArray K, InputArray D, InputArray xi, InputArray R, InputArray P, const cv::Size& size,
         int mltype, OutputArray map1, OutputArray map2, int flags);
 
+    /** @brief Computes the maps of initUndistortRectifyMap and which of their pixels are valid
+
+    @param K Camera matrix \f$K = \vecthreethree{f_x}{s}{c_x}{0}{f_y}{c_y}{0}{0}{_1}\f$, with depth CV_32F or CV_64F
+    @param D Input vector of distortion coefficients \f$(k_1, k_2, p_1, p_2)\f$, with depth CV_32F or CV_64F
+    @param xi The parameter xi for CMei's model
+    @param R Rotation transform between the original and object space : 3x3 1-channel, or vector: 3x1/1x3, with depth CV_32F or CV_64F
+    @param P New camera matrix (3x3) or new projection matrix (3x4)
+    @param size Undistorted image size.
+    @param mltype Type of the first output map that can be CV_32FC1 or CV_16SC2 . See convertMaps()
+    for details.
+    @param map1 The first output map.
+    @param map2 The second output map.
+    @param flags Flags indicates the rectification type,  RECTIFY_PERSPECTIVE, RECTIFY_CYLINDRICAL, RECTIFY_LONGLATI and RECTIFY_STEREOGRAPHIC
+    are supported.
+    @param imageSize Size of the distorted image.
+    @param mask Output CV_8U mask of the size of the maps, 255 at the valid pixels and 0 elsewhere.
+    @param spans Optional output of the runs of valid pixels, as Vec3i (row, first column, column after the last),
+    row after row.
+
+    A pixel is valid when its ray is in the part of the unit sphere that the model projects one to one, the
+    points with \f$Z_s > -\min(\xi, 1/\xi)\f$, and its distorted pixel is inside the distorted image. Invalid
+    pixels can then be skipped rather than remapped to the border and masked afterwards.
+     */
+    CV_EXPORTS_W void initUndistortRectifyMap(InputArray K, InputArray D, InputArray xi, InputArray R, InputArray P, const cv::Size& size,
+        int mltype, OutputArray map1, OutputArray map2, int flags, const Size& imageSize, OutputArray mask,
+        OutputArray spans = noArray());
+
+    /** @brief Computes the maps of initUndistortRectifyMap from the exact map on a coarse grid
+
+    @param K Camera matrix \f$K = \vecthreethree{f_x}{s}{c_x}{0}{f_y}{c_y}{0}{0}{_1}\f$.
+    @param D Input vector of distortion coefficients \f$(k_1, k_2, p_1, p_2)\f$.
+    @param xi The parameter xi for CMei's model
+    @param R Rotation transform between the original and object space : 3x3 1-channel, or vector: 3x1/1x3, with depth CV_32F or CV_64F
+    @param P New camera matrix (3x3) or new projection matrix (3x4)
+    @param size Undistorted image size.
+    @param mltype Type of the first output map that can be CV_32FC1 or CV_16SC2 . See convertMaps()
+    for details.
+    @param map1 The first output map.
+    @param map2 The second output map.
+    @param flags Flags indicates the rectification type,  RECTIFY_PERSPECTIVE, RECTIFY_CYLINDRICAL, RECTIFY_LONGLATI and RECTIFY_STEREOGRAPHIC
+    are supported.
+    @param gridStep Distance in pixels between the grid nodes, N
+    @param maxError Bound in pixels of the interpolation error
+    @param cellError Optional output CV_32F error estimate of each gridStep x gridStep cell, in pixels
+
+    The exact map is computed only on every gridStep-th row and column, and the maps in between are bilinearly
+    interpolated, which cuts the projections of a cell from gridStep squared to 14 where it is interpolated. The
+    interpolation error of a cell is sampled on a 3x3 lattice inside it and at its edge midpoints; cells where
+    it exceeds 0.8 maxError, or where the projection is not defined, as near the edge of the field of view, are
+    computed exactly and get an error of 0. The margin keeps the error between the samples under maxError for
+    maps that are smooth at the scale of a cell. The maps are still full resolution, so the memory is not
+    reduced, only the time to compute them.
+     */
+    CV_EXPORTS_W void initUndistortRectifyMapCoarse(InputArray K, InputArray D, InputArray xi, InputArray R, InputArray P,
+        const cv::Size& size, int mltype, OutputArray map1, OutputArray map2, int flags, int gridStep, double maxError = 0.1,
+        OutputArray cellError = noArray());
+
+    /** @brief Computes the maps of initUndistortRectifyMap for a rectangle of the undistorted image only
+
+    @param K Camera matrix \f$K = \vecthreethree{f_x}{s}{c_x}{0}{f_y}{c_y}{0}{0}{_1}\f$, with depth CV_32F or CV_64F
+    @param D Input vector of distortion coefficients \f$(k_1, k_2, p_1, p_2)\f$, with depth CV_32F or CV_64F
+    @param xi The parameter xi for CMei's model
+    @param R Rotation transform between the original and object space : 3x3 1-channel, or vector: 3x1/1x3, with depth CV_32F or CV_64F
+    @param P New camera matrix (3x3) or new projection matrix (3x4)
+    @param roi The rectangle of the undistorted image, with non negative corner. The maps are of its size.
+    @param imageSize Size of the distorted image.
+    @param mltype Type of the first output map that can be CV_32FC1 or CV_16SC2 . See convertMaps()
+    for details.
+    @param map1 The first output map.
+    @param map2 The second output map.
+    @param flags Flags indicates the rectification type,  RECTIFY_PERSPECTIVE, RECTIFY_CYLINDRICAL, RECTIFY_LONGLATI and RECTIFY_STEREOGRAPHIC
+    are supported.
+    @param relative Whether the maps point into the returned rectangle rather than into the whole distorted image.
+    @return The rectangle of the distorted image that cv::remap with the maps reads, for up to INTER_LINEAR
+    interpolation, so that only that part of a frame has to be decoded or uploaded. With relative maps, cv::remap of
+    that part gives the same image as cv::remap of the whole image with the other maps for BORDER_CONSTANT and
+    BORDER_TRANSPARENT.
+     */
+    CV_EXPORTS_W Rect initUndistortRectifyMapROI(InputArray K, InputArray D, InputArray xi, InputArray R, InputArray P,
+        const Rect& roi, const Size& imageSize, int mltype, OutputArray map1, OutputArray map2, int flags,
+        bool relative = false);
+
+    /** @brief Computes the maps of initUndistortRectifyMap for a pyramid of undistorted image sizes
+
+    @param K Camera matrix \f$K = \vecthreethree{f_x}{s}{c_x}{0}{f_y}{c_y}{0}{0}{_1}\f$, with depth CV_32F or CV_64F
+    @param D Input vector of distortion coefficients \f$(k_1, k_2, p_1, p_2)\f$, with depth CV_32F or CV_64F
+    @param xi The parameter xi for CMei's model
+    @param R Rotation transform between the original and object space : 3x3 1-channel, or vector: 3x1/1x3, with depth CV_32F or CV_64F
+    @param P New camera matrix (3x3) or new projection matrix (3x4)
+    @param size Undistorted image size of level 0.
+    @param mltype Type of the first output maps that can be CV_32FC1 or CV_16SC2 . See convertMaps()
+    for details.
+    @param map1 The first output maps, one per level.
+    @param map2 The second output maps, one per level.
+    @param flags Flags indicates the rectification type,  RECTIFY_PERSPECTIVE, RECTIFY_CYLINDRICAL, RECTIFY_LONGLATI and RECTIFY_STEREOGRAPHIC
+    are supported.
+    @param maxLevel Index of the coarsest level, as in buildPyramid.
+
+    Level 0 holds the maps of initUndistortRectifyMap. Each following level has the size of pyrDown,
+    ((width + 1)/2, (height + 1)/2), and its pixel (x, y) is the pixel (2x, 2y) of the level before, so that
+    level l is the map of initUndistortRectifyMap for P with its first two rows divided by \f$2^l\f$. The
+    projection is only evaluated for level 0; the other levels are taken from its values, which makes them
+    consistent with it to the last bit.
+     */
+    CV_EXPORTS_W void initUndistortRectifyMapPyramid(InputArray K, InputArray D, InputArray xi, InputArray R, InputArray P,
+        const cv::Size& size, int mltype, OutputArrayOfArrays map1, OutputArrayOfArrays map2, int flags, int maxLevel);
+
+    /** @brief Saves the maps of initUndistortRectifyMap to a file that loadRectifyMaps maps into memory
+
+    @param filename Name of the file, which is replaced atomically
+    @param K Camera matrix \f$K = \vecthreethree{f_x}{s}{c_x}{0}{f_y}{c_y}{0}{0}{_1}\f$.
+    @param D Input vector of distortion coefficients \f$(k_1, k_2, p_1, p_2)\f$.
+    @param xi The parameter xi for CMei's model
+    @param R Rotation transform between the original and object space, as in initUndistortRectifyMap
+    @param P New camera matrix (3x3) or new projection matrix (3x4)
+    @param size Undistorted image size.
+    @param map1 The first map, CV_16SC2 or CV_32FC1
+    @param map2 The second map, CV_16UC1 or CV_32FC1
+    @param flags Rectification type of the maps
+
+    The file is a versioned binary header followed by the raw map rows, in the byte order of the host. The
+    header holds the parameters the maps were computed for and a hash of them, which is also the name
+    rectifyMapCacheFile gives the file. Returns false when the file cannot be written.
+     */
+    CV_EXPORTS_W bool saveRectifyMaps(const String& filename, InputArray K, InputArray D, InputArray xi, InputArray R,
+        InputArray P, const Size& size, InputArray map1, InputArray map2, int flags);
+
+    /** @brief Loads maps saved by saveRectifyMaps for the given parameters
+
+    The parameters are those of initUndistortRectifyMap. Returns false, leaving the maps untouched, when the
+    file is missing or was saved for other parameters, another map type or another version of the format. On
+    POSIX systems the file is mapped into memory without parsing or copying, and the Mat outputs point into
+    the mapping: processes that load the same file share its pages, and the mapping is released with the last
+    Mat. Writing to the maps only changes the private copy of the process.
+     */
+    CV_EXPORTS_W bool loadRectifyMaps(const String& filename, InputArray K, InputArray D, InputArray xi, InputArray R,
+        InputArray P, const Size& size, int mltype, OutputArray map1, OutputArray map2, int flags);
+
+    /** @brief Sets the directory of the map files of Undistorter, undistortImage and stereoReconstruct
+
+    When it is set, maps are loaded from rectifyMapCacheFile in it when they were saved before, and saved there
+    after they are computed otherwise. An empty dir, the default, disables the files.
+     */
+    CV_EXPORTS_W void setRectifyMapCacheDir(const String& dir);
+
+    /** @brief Name of the file in the directory of setRectifyMapCacheDir for the maps of the given parameters,
+    or an empty string when no directory is set. The parameters are those of initUndistortRectifyMap.
+     */
+    CV_EXPORTS_W String rectifyMapCacheFile(InputArray K, InputArray D, InputArray xi, InputArray R, InputArray P,
+        const Size& size, int mltype, int flags);
+
     /** @brief Undistort omnidirectional images to perspective images
 
     @param distorted The input omnidirectional image.
@@ -151,6 +450,481 @@ namespace omnidir
     CV_EXPORTS_W void undistortImage(InputArray distorted, OutputArray undistorted, InputArray K, InputArray D, InputArray xi, int flags,
         InputArray Knew = cv::noArray(), const Size& new_size = Size(), InputArray R = Mat::eye(3, 3, CV_64F));
 
+    /** @brief Undistort omnidirectional images without rectification maps
+
+    @param distorted The input omnidirectional image.
+    @param undistorted The output undistorted image.
+    @param K Camera matrix \f$K = \vecthreethree{f_x}{s}{c_x}{0}{f_y}{c_y}{0}{0}{_1}\f$.
+    @param D Input vector of distortion coefficients \f$(k_1, k_2, p_1, p_2)\f$.
+    @param xi The parameter xi for CMei's model.
+    @param flags Flags indicates the rectification type,  RECTIFY_PERSPECTIVE, RECTIFY_CYLINDRICAL, RECTIFY_LONGLATI and RECTIFY_STEREOGRAPHIC
+    @param Knew Camera matrix of the distorted image. If it is not assigned, it is just K.
+    @param new_size The new image size. By default, it is the size of distorted.
+    @param R Rotation matrix between the input and output images. By default, it is identity matrix.
+    @param interpolation Interpolation of cv::remap
+    @param borderMode Border mode of cv::remap
+
+    The output is the same as undistortImage, but the maps of initUndistortRectifyMap are never stored. The
+    output is processed in small tiles whose maps are computed on the stack and consumed by cv::remap right
+    away, so the memory traffic per output pixel is the source pixels only. Use it for outputs too large to keep
+    maps for, or for many cameras on a small host; when the maps fit, an Undistorter is cheaper per frame.
+    */
+    CV_EXPORTS_W void rectifyImage(InputArray distorted, OutputArray undistorted, InputArray K, InputArray D, InputArray xi, int flags,
+        InputArray Knew = cv::noArray(), const Size& new_size = Size(), InputArray R = cv::noArray(),
+        int interpolation = INTER_LINEAR, int borderMode = BORDER_CONSTANT);
+
+    /** @brief Undistorts a rectangle of the undistorted image only, see rectifyImage
+
+    @param distorted The input omnidirectional image.
+    @param undistorted The output image, of the size of roi.
+    @param K Camera matrix \f$K = \vecthreethree{f_x}{s}{c_x}{0}{f_y}{c_y}{0}{0}{_1}\f$.
+    @param D Input vector of distortion coefficients \f$(k_1, k_2, p_1, p_2)\f$.
+    @param xi The parameter xi for CMei's model.
+    @param flags Flags indicates the rectification type,  RECTIFY_PERSPECTIVE, RECTIFY_CYLINDRICAL, RECTIFY_LONGLATI and RECTIFY_STEREOGRAPHIC
+    @param Knew Camera matrix of the undistorted image.
+    @param roi The rectangle of the undistorted image, with non negative corner.
+    @param R Rotation matrix between the input and output images. By default, it is identity matrix.
+    @param interpolation Interpolation of cv::remap
+    @param borderMode Border mode of cv::remap
+
+    The output is the roi of undistortImage with the same parameters, computed without maps for the rest of the
+    image.
+    */
+    CV_EXPORTS_W void undistortImageROI(InputArray distorted, OutputArray undistorted, InputArray K, InputArray D,
+        InputArray xi, int flags, InputArray Knew, const Rect& roi, InputArray R = cv::noArray(),
+        int interpolation = INTER_LINEAR, int borderMode = BORDER_CONSTANT);
+
+    /** @brief Undistorts omnidirectional images into a pyramid of undistorted images
+
+    @param distorted The input omnidirectional image.
+    @param undistorted The output images, one per level, of the sizes of initUndistortRectifyMapPyramid.
+    @param K Camera matrix \f$K = \vecthreethree{f_x}{s}{c_x}{0}{f_y}{c_y}{0}{0}{_1}\f$.
+    @param D Input vector of distortion coefficients \f$(k_1, k_2, p_1, p_2)\f$.
+    @param xi The parameter xi for CMei's model.
+    @param flags Flags indicates the rectification type,  RECTIFY_PERSPECTIVE, RECTIFY_CYLINDRICAL, RECTIFY_LONGLATI and RECTIFY_STEREOGRAPHIC
+    @param Knew Camera matrix of level 0 of the undistorted images.
+    @param maxLevel Index of the coarsest level, as in buildPyramid.
+    @param new_size The size of level 0. By default, it is the size of distorted.
+    @param R Rotation matrix between the input and output images. By default, it is identity matrix.
+    @param interpolation Interpolation of cv::remap
+    @param borderMode Border mode of cv::remap
+
+    Level 0 is remapped from the distorted image with the maps of initUndistortRectifyMapPyramid. The coarse
+    levels are remapped tile by tile from the pyramid of the distorted image, as built by buildPyramid, so that
+    they are filtered about like the pyrDown of level 0 rather than sampled at single points. A tile of level l
+    is read from the source level \f$s = l + \log_2 \sigma\f$, rounded and clamped to [0, maxLevel], where
+    \f$\sigma\f$ is the number of distorted pixels per pixel of level 0 at its centre. The filtering is
+    therefore only exact where \f$\sigma\f$ is a power of two and constant over the tile, is coarser or
+    finer by up to a factor \f$\sqrt 2\f$ elsewhere, and is too fine where s is clamped to maxLevel. The
+    source pyramid is a blur and downsample pass over the whole distorted image, but not over the undistorted
+    levels.
+    */
+    CV_EXPORTS_W void undistortImagePyramid(InputArray distorted, OutputArrayOfArrays undistorted, InputArray K,
+        InputArray D, InputArray xi, int flags, InputArray Knew, int maxLevel, const Size& new_size = Size(),
+        InputArray R = cv::noArray(), int interpolation = INTER_LINEAR, int borderMode = BORDER_CONSTANT);
+
+    /** @brief Undistorts the images of one camera with remap tables that are computed once
+
+    undistortImage computes the maps of initUndistortRectifyMap for every image. An Undistorter keeps them for
+    its parameters, so that undistorting a video costs one cv::remap per frame. The maps are built by create()
+    when new_size is given, otherwise by the first apply() for the size of its image, and again whenever that
+    size changes. undistortImage keeps a few Undistorters for the parameters it has seen last.
+     */
+    class CV_EXPORTS Undistorter
+    {
+    public:
+        Undistorter();
+
+        /** @brief Sets the parameters, see create() */
+        Undistorter(InputArray K, InputArray D, InputArray xi, int flags, InputArray Knew = cv::noArray(),
+            const Size& new_size = Size(), InputArray R = cv::noArray());
+
+        /** @brief Sets the parameters, with the same meaning as in undistortImage
+
+        @param K Camera matrix \f$K = \vecthreethree{f_x}{s}{c_x}{0}{f_y}{c_y}{0}{0}{_1}\f$.
+        @param D Input vector of distortion coefficients \f$(k_1, k_2, p_1, p_2)\f$.
+        @param xi The parameter xi for CMei's model.
+        @param flags Flags indicates the rectification type,  RECTIFY_PERSPECTIVE, RECTIFY_CYLINDRICAL, RECTIFY_LONGLATI and RECTIFY_STEREOGRAPHIC
+        @param Knew Camera matrix of the distorted image. If it is not assigned, it is just K.
+        @param new_size The new image size. By default, it is the size of the images passed to apply().
+        @param R Rotation matrix between the input and output images. By default, it is identity matrix.
+         */
+        void create(InputArray K, InputArray D, InputArray xi, int flags, InputArray Knew = cv::noArray(),
+            const Size& new_size = Size(), InputArray R = cv::noArray());
+
+        /** @brief Undistorts an image, see undistortImage
+
+        @param distorted The input omnidirectional image.
+        @param undistorted The output undistorted image. Its buffer is reused when it has the right size and type.
+        @param interpolation Interpolation of cv::remap
+        @param borderMode Border mode of cv::remap
+         */
+        void apply(InputArray distorted, OutputArray undistorted, int interpolation = INTER_LINEAR,
+            int borderMode = BORDER_CONSTANT);
+
+        //! The maps for cv::remap, empty until they are built
+        const Mat& map1() const { return _map1; }
+        const Mat& map2() const { return _map2; }
+
+        bool empty() const { return _flags < 0; }
+
+    private:
+        void createMaps(const Size& size);
+
+        Matx33d _K, _Knew, _R;
+        Vec4d _D;
+        double _xi;
+        int _flags;
+        Size _newSize;
+        Mat _map1, _map2;   // CV_16SC2 and CV_16UC1
+    };
+
+    /** @brief Renders the six 90 degree perspective faces of a cube around an omnidirectional camera
+
+    The maps of all faces are computed once by create(). render() then fills all faces, or any subset of them,
+    in one parallel pass over the source, into a single buffer with the faces either stacked from top to
+    bottom in the order of the face enum (LAYOUT_PACKED), or unfolded into a horizontal cross (LAYOUT_CROSS):
+    @code
+         .   -Y    .    .
+        -X   +Z   +X   -Z
+         .   +Y    .    .
+    @endcode
+    The faces are in the frame of the camera rotated by R, x to the right, y down and z forward, and each face
+    looks along its axis with its edges shared with those of its neighbours in the cross.
+     */
+    class CV_EXPORTS CubemapRenderer
+    {
+    public:
+        enum
+        {
+            FACE_POSITIVE_X = 0,
+            FACE_NEGATIVE_X = 1,
+            FACE_POSITIVE_Y = 2,
+            FACE_NEGATIVE_Y = 3,
+            FACE_POSITIVE_Z = 4,
+            FACE_NEGATIVE_Z = 5,
+            FACE_COUNT      = 6,
+            ALL_FACES       = (1 << FACE_COUNT) - 1  //!< mask of all faces, face i being bit 1 << i
+        };
+
+        enum
+        {
+            LAYOUT_PACKED   = 0,    //!< faceSize x 6*faceSize, the faces in their order
+            LAYOUT_CROSS    = 1     //!< 4*faceSize x 3*faceSize, the faces unfolded
+        };
+
+        CubemapRenderer();
+
+        /** @brief Computes the maps, see create() */
+        CubemapRenderer(InputArray K, InputArray D, InputArray xi, int faceSize, InputArray R = cv::noArray());
+
+        /** @brief Computes the maps of the six faces
+
+        @param K Camera matrix \f$K = \vecthreethree{f_x}{s}{c_x}{0}{f_y}{c_y}{0}{0}{_1}\f$.
+        @param D Input vector of distortion coefficients \f$(k_1, k_2, p_1, p_2)\f$.
+        @param xi The parameter xi for CMei's model.
+        @param faceSize Width and height of each face in pixels.
+        @param R Rotation of the cube with respect to the camera, as in undistortImage. By default, it is identity matrix.
+         */
+        void create(InputArray K, InputArray D, InputArray xi, int faceSize, InputArray R = cv::noArray());
+
+        /** @brief Renders faces of an omnidirectional image
+
+        @param distorted The input omnidirectional image.
+        @param cubemap The output buffer, of the size of the layout. It is reused when it has the right size and type,
+        and its faces that are not rendered and the empty cells of the cross are then left unchanged, otherwise
+        it is allocated and cleared.
+        @param layout LAYOUT_PACKED or LAYOUT_CROSS.
+        @param faces Mask of the faces to render, face i being bit 1 << i.
+        @param interpolation Interpolation of cv::remap
+        @param borderMode Border mode of cv::remap
+         */
+        void render(InputArray distorted, OutputArray cubemap, int layout = LAYOUT_PACKED, int faces = ALL_FACES,
+            int interpolation = INTER_LINEAR, int borderMode = BORDER_CONSTANT) const;
+
+        /** @brief The rectangle of a face in the buffer of a layout */
+        Rect faceRect(int face, int layout = LAYOUT_PACKED) const;
+
+        /** @brief The rotation from the camera to a face, including R, such that the face is the RECTIFY_PERSPECTIVE
+        rectification of the camera by that rotation with camera matrix
+        \f$\vecthreethree{n/2}{0}{(n-1)/2}{0}{n/2}{(n-1)/2}{0}{0}{_1}\f$, n being faceSize */
+        Matx33d faceRotation(int face) const;
+
+        //! The maps for cv::remap of the faces, stacked as in LAYOUT_PACKED, empty until create()
+        const Mat& map1() const { return _map1; }
+        const Mat& map2() const { return _map2; }
+
+        int faceSize() const { return _faceSize; }
+        bool empty() const { return _faceSize <= 0; }
+
+    private:
+        int _faceSize;
+        Matx33d _R;
+        Mat _map1, _map2;   // CV_16SC2 and CV_16UC1
+    };
+
+    /** @brief A virtual pan-tilt-zoom camera looking through an omnidirectional one
+
+    The rays of the output pixels before the rotation R of undistortImage only depend on Knew, flags and the
+    output size, so a VirtualCamera computes them once in create(). Steering it with setRotation() or render()
+    then only rotates the rays and projects them into the omnidirectional image, which is cheap enough to be done
+    for every frame. A zoom is a new Knew and so a new create().
+     */
+    class CV_EXPORTS VirtualCamera
+    {
+    public:
+        VirtualCamera();
+
+        /** @brief Computes the rays, see create() */
+        VirtualCamera(InputArray K, InputArray D, InputArray xi, int flags, InputArray Knew, const Size& new_size);
+
+        /** @brief Computes the rays of the output pixels, and the maps for the identity rotation
+
+        @param K Camera matrix \f$K = \vecthreethree{f_x}{s}{c_x}{0}{f_y}{c_y}{0}{0}{_1}\f$.
+        @param D Input vector of distortion coefficients \f$(k_1, k_2, p_1, p_2)\f$.
+        @param xi The parameter xi for CMei's model.
+        @param flags Flags indicates the rectification type,  RECTIFY_PERSPECTIVE, RECTIFY_CYLINDRICAL, RECTIFY_LONGLATI and RECTIFY_STEREOGRAPHIC
+        @param Knew Camera matrix of the output image.
+        @param new_size Size of the output image.
+         */
+        void create(InputArray K, InputArray D, InputArray xi, int flags, InputArray Knew, const Size& new_size);
+
+        /** @brief Updates the maps for a new rotation
+
+        @param R Rotation matrix between the input and output images, as in undistortImage.
+         */
+        void setRotation(InputArray R);
+
+        /** @brief Remaps an image with the maps of the current rotation
+
+        @param distorted The input omnidirectional image.
+        @param undistorted The output image.
+        @param interpolation Interpolation of cv::remap
+        @param borderMode Border mode of cv::remap
+         */
+        void apply(InputArray distorted, OutputArray undistorted, int interpolation = INTER_LINEAR,
+            int borderMode = BORDER_CONSTANT) const;
+
+        /** @brief setRotation and apply in one pass, each tile of the maps being remapped right after its update
+
+        @param distorted The input omnidirectional image.
+        @param undistorted The output image.
+        @param R Rotation matrix between the input and output images, as in undistortImage.
+        @param interpolation Interpolation of cv::remap
+        @param borderMode Border mode of cv::remap
+         */
+        void render(InputArray distorted, OutputArray undistorted, InputArray R, int interpolation = INTER_LINEAR,
+            int borderMode = BORDER_CONSTANT);
+
+        //! The maps for cv::remap of the current rotation, empty until create()
+        const Mat& map1() const { return _map1; }
+        const Mat& map2() const { return _map2; }
+
+        //! The CV_32FC3 rays of the output pixels before the rotation
+        const Mat& rays() const { return _rays; }
+
+        const Matx33d& rotation() const { return _R; }
+        bool empty() const { return _rays.empty(); }
+
+    private:
+        Matx33d _K, _R;
+        Vec4d _D;
+        double _xi;
+        Mat _rays;
+        Mat _map1, _map2;   // CV_16SC2 and CV_16UC1
+    };
+
+    /** @brief A rectified view of an omnidirectional camera, with the parameters of undistortImage */
+    struct CV_EXPORTS Viewport
+    {
+        Viewport() : Knew(Matx33d::eye()), R(Matx33d::eye()), flags(RECTIFY_PERSPECTIVE) {}
+        Viewport(const Matx33d& _Knew, const Matx33d& _R, const Size& _size, int _flags = RECTIFY_PERSPECTIVE)
+            : Knew(_Knew), R(_R), size(_size), flags(_flags) {}
+
+        Matx33d Knew;   //!< camera matrix of the view
+        Matx33d R;      //!< rotation matrix between the camera and the view
+        Size size;      //!< size of the view
+        int flags;      //!< RECTIFY_PERSPECTIVE, RECTIFY_CYLINDRICAL, RECTIFY_LONGLATI or RECTIFY_STEREOGRAPHIC
+    };
+
+    /** @brief Renders several viewports of an omnidirectional image in one pass
+
+    Undistorting each viewport on its own reads the source image once per viewport. A ViewportRenderer computes
+    the maps of all viewports once in create(), cuts them into small tiles and orders the tiles of all viewports by
+    the region of the source they read. render() remaps them in that order, each thread taking runs of
+    consecutive tiles, so that viewports that look at the same part of the scene share the source pixels while
+    they are in the cache.
+     */
+    class CV_EXPORTS ViewportRenderer
+    {
+    public:
+        ViewportRenderer();
+
+        /** @brief Computes the maps, see create() */
+        ViewportRenderer(InputArray K, InputArray D, InputArray xi, const std::vector<Viewport>& viewports);
+
+        /** @brief Computes the maps of the viewports and the order of their tiles
+
+        @param K Camera matrix \f$K = \vecthreethree{f_x}{s}{c_x}{0}{f_y}{c_y}{0}{0}{_1}\f$.
+        @param D Input vector of distortion coefficients \f$(k_1, k_2, p_1, p_2)\f$.
+        @param xi The parameter xi for CMei's model.
+        @param viewports The viewports to render.
+         */
+        void create(InputArray K, InputArray D, InputArray xi, const std::vector<Viewport>& viewports);
+
+        /** @brief Renders all viewports of an image
+
+        @param distorted The input omnidirectional image.
+        @param views The output images, one per viewport. Their buffers are reused when they have the right size
+        and type, regions of a larger image included, so that views allocated once are rendered into without
+        allocation.
+        @param interpolation Interpolation of cv::remap
+        @param borderMode Border mode of cv::remap
+         */
+        void render(InputArray distorted, OutputArrayOfArrays views, int interpolation = INTER_LINEAR,
+            int borderMode = BORDER_CONSTANT) const;
+
+        const std::vector<Viewport>& viewports() const { return _viewports; }
+
+        //! The maps for cv::remap of viewport i
+        const Mat& map1(int i) const { return _map1[i]; }
+        const Mat& map2(int i) const { return _map2[i]; }
+
+        bool empty() const { return _viewports.empty(); }
+
+    private:
+        std::vector<Viewport> _viewports;
+        std::vector<Mat> _map1, _map2;  // CV_16SC2 and CV_16UC1
+        std::vector<Vec3i> _tiles;      // viewport and top left corner of the tiles, in the order of render()
+    };
+
+    /** @brief cv::remap with maps of omnidirectional images, in an order that keeps the source reads local
+
+    A row of a RECTIFY_LONGLATI or RECTIFY_CYLINDRICAL map runs along an arc of the omnidirectional image, so
+    remapping row after row reads the source all over for every few output rows. A TiledRemapper cuts the
+    output into square tiles, whose footprints in the source are compact, computes the bounding box of each
+    footprint once in create(), and orders the tiles by the place of their footprint in the source. remap()
+    then goes through the tiles in that order, fetching the footprint of the next tile into the cache while
+    remapping the current one.
+     */
+    class CV_EXPORTS TiledRemapper
+    {
+    public:
+        TiledRemapper();
+
+        /** @brief Computes the tiles of the maps, see create() */
+        TiledRemapper(InputArray map1, InputArray map2, const Size& tileSize = Size(32, 32));
+
+        /** @brief Computes the tiles of maps and their order
+
+        @param map1 The first map of cv::remap, CV_16SC2 or CV_32FC1 as from initUndistortRectifyMap. It is kept
+        without a copy.
+        @param map2 The second map of cv::remap, CV_16UC1 or CV_32FC1, kept without a copy.
+        @param tileSize Size of the tiles of the output.
+         */
+        void create(InputArray map1, InputArray map2, const Size& tileSize = Size(32, 32));
+
+        /** @brief cv::remap of an image with the maps
+
+        @param src The input image.
+        @param dst The output image, of the size of the maps.
+        @param interpolation Interpolation of cv::remap
+        @param borderMode Border mode of cv::remap
+        @param borderValue Border value of cv::remap
+         */
+        void remap(InputArray src, OutputArray dst, int interpolation = INTER_LINEAR,
+            int borderMode = BORDER_CONSTANT, const Scalar& borderValue = Scalar()) const;
+
+        //! Number of tiles
+        int tiles() const { return (int)_tiles.size(); }
+
+        //! Tile i in the order of remap(), in the output
+        Rect tile(int i) const { return _tiles[i]; }
+
+        //! Bounding box of the integer parts of the source coordinates of tile i, empty when they are all NaN.
+        //! The interpolation also reads the pixels around it.
+        Rect sourceRect(int i) const { return _sources[i]; }
+
+        const Mat& map1() const { return _map1; }
+        const Mat& map2() const { return _map2; }
+
+        bool empty() const { return _tiles.empty(); }
+
+    private:
+        Mat _map1, _map2;
+        std::vector<Rect> _tiles, _sources;
+    };
+
+    /** @brief Rectification maps in about a third of the memory of CV_16SC2 maps
+
+    CV_16SC2 and CV_16UC1 maps take 6 bytes per pixel. A CompactMap keeps the same fixed point coordinates, in
+    1/INTER_TAB_SIZE pixels, as their bilinear interpolation between the nodes of a coarse grid plus a CV_8SC2
+    correction per pixel, about 2.2 bytes per pixel for a grid step of 8. The grid cells whose corrections do not
+    fit in 8 bits keep the exact coordinates instead. The encoding is lossless, and remap() decodes the maps tile by
+    tile into buffers that stay in the cache, so that it gives the image of cv::remap with the CV_16SC2 maps while
+    reading only the compact ones from memory.
+     */
+    class CV_EXPORTS CompactMap
+    {
+    public:
+        CompactMap();
+
+        /** @brief Encodes the maps of initUndistortRectifyMap
+
+        @param K Camera matrix \f$K = \vecthreethree{f_x}{s}{c_x}{0}{f_y}{c_y}{0}{0}{_1}\f$, with depth CV_32F or CV_64F
+        @param D Input vector of distortion coefficients \f$(k_1, k_2, p_1, p_2)\f$, with depth CV_32F or CV_64F
+        @param xi The parameter xi for CMei's model
+        @param R Rotation transform between the original and object space : 3x3 1-channel, or vector: 3x1/1x3, with depth CV_32F or CV_64F
+        @param P New camera matrix (3x3) or new projection matrix (3x4)
+        @param size Undistorted image size.
+        @param flags Flags indicates the rectification type,  RECTIFY_PERSPECTIVE, RECTIFY_CYLINDRICAL, RECTIFY_LONGLATI and RECTIFY_STEREOGRAPHIC
+        @param gridStep Step of the grid in pixels, 2, 4, 8 or 16.
+         */
+        void create(InputArray K, InputArray D, InputArray xi, InputArray R, InputArray P, const Size& size, int flags,
+            int gridStep = 8);
+
+        /** @brief Encodes maps of cv::remap
+
+        @param map1 The first map, in any format of convertMaps. Maps that are not CV_16SC2 are rounded to it.
+        @param map2 The second map. It may be empty with CV_16SC2 map1, for integer coordinates.
+        @param gridStep Step of the grid in pixels, 2, 4, 8 or 16.
+         */
+        void create(InputArray map1, InputArray map2, int gridStep = 8);
+
+        /** @brief cv::remap of an image with the maps
+
+        @param src The input image.
+        @param dst The output image, of the size of the maps.
+        @param interpolation Interpolation of cv::remap
+        @param borderMode Border mode of cv::remap
+        @param borderValue Border value of cv::remap
+         */
+        void remap(InputArray src, OutputArray dst, int interpolation = INTER_LINEAR,
+            int borderMode = BORDER_CONSTANT, const Scalar& borderValue = Scalar()) const;
+
+        /** @brief Decodes the maps into the CV_16SC2 and CV_16UC1 maps of cv::remap */
+        void decode(OutputArray map1, OutputArray map2) const;
+
+        //! Bytes taken by the encoded maps
+        size_t memorySize() const;
+
+        Size size() const { return _deltas.size(); }
+        int gridStep() const { return 1 << _shift; }
+        bool empty() const { return _deltas.empty(); }
+
+        //! The parts of the encoding: the CV_32SC2 fixed point coordinates of the grid nodes, the CV_8SC2
+        //! corrections of the pixels, per grid cell CV_32S -1 or the index in exact() of its first pixel, and
+        //! the CV_32SC2 fixed point coordinates of those cells, row by row of gridStep pixels
+        const Mat& nodes() const { return _nodes; }
+        const Mat& deltas() const { return _deltas; }
+        const Mat& cells() const { return _cells; }
+        const Mat& exact() const { return _exact; }
+
+    private:
+        int _shift;
+        Mat _nodes, _deltas, _cells, _exact;
+    };
+
     /** @brief Perform omnidirectional camera calibration, the default depth of outputs is CV_64F.
 
     @param objectPoints Vector of vector of Vec3f object points in world (pattern) coordinate.
@@ -167,11 +941,37 @@ namespace omnidir
     @param criteria Termination criteria for optimization
     @param idx Indices of images that pass initialization, which are really used in calibration. So the size of rvecs is the
     same as idx.total().
+
+    With CALIB_MIXED_PRECISION the projections and jacobians of the optimization are evaluated in float, with SIMD
+    where available, while JTJ and JTE are accumulated and solved in double. The jacobian entries agree with the
+    double path to about 1e-6 relative error and the projections to about 1e-4 pixel. The returned rms and the
+    uncertainties are always computed in double, so they measure the mixed precision solution by the same standard
+    as the double one. The overload with mixedPrecisionStep measures how far the solution is from that of the double
+    path. The flag is also accepted by stereoCalibrate, whose overload with mixedPrecisionStep measures it the same way.
     */
     CV_EXPORTS_W double calibrate(InputArrayOfArrays objectPoints, InputArrayOfArrays imagePoints, Size size,
         InputOutputArray K, InputOutputArray xi, InputOutputArray D, OutputArrayOfArrays rvecs, OutputArrayOfArrays tvecs,
         int flags, TermCriteria criteria, OutputArray idx=noArray());
 
+    /** @overload
+
+    @param mixedPrecisionStep Output relative size, \f$\|\Delta\| / \|p\|\f$ as for criteria.epsilon, of the step
+    that one Gauss-Newton iteration in double precision would still take from the solution. It is 0 without
+    CALIB_MIXED_PRECISION.
+    */
+    CV_EXPORTS_W double calibrate(InputArrayOfArrays objectPoints, InputArrayOfArrays imagePoints, Size size,
+        InputOutputArray K, InputOutputArray xi, InputOutputArray D, OutputArrayOfArrays rvecs, OutputArrayOfArrays tvecs,
+        int flags, TermCriteria criteria, OutputArray idx, CV_OUT double& mixedPrecisionStep);
+
+    /** @overload
+
+    @param Dinv Output closed form inverse of the calibrated distortion, see fitInverseDistortion
+    @param inverseError Output largest reprojection error in pixels of Dinv over the calibration image size
+    */
+    CV_EXPORTS_W double calibrate(InputArrayOfArrays objectPoints, InputArrayOfArrays imagePoints, Size size,
+        InputOutputArray K, InputOutputArray xi, InputOutputArray D, OutputArrayOfArrays rvecs, OutputArrayOfArrays tvecs,
+        int flags, TermCriteria criteria, OutputArray idx, OutputArray Dinv, CV_OUT double& inverseError);
+
     /** @brief Stereo calibration for omnidirectional camera model. It computes the intrinsic parameters for two
     cameras and the extrinsic parameters between two cameras. The default depth of outputs is CV_64F.
 
@@ -203,6 +1003,29 @@ namespace omnidir
         const Size& imageSize1, const Size& imageSize2, InputOutputArray K1, InputOutputArray xi1, InputOutputArray D1, InputOutputArray K2, InputOutputArray xi2,
         InputOutputArray D2, OutputArray rvec, OutputArray tvec, OutputArrayOfArrays rvecsL, OutputArrayOfArrays tvecsL, int flags, TermCriteria criteria, OutputArray idx=noArray());
 
+    /** @overload
+
+    @param mixedPrecisionStep Output relative size, \f$\|\Delta\| / \|p\|\f$ as for criteria.epsilon, of the step
+    that one Gauss-Newton iteration in double precision would still take from the solution of both cameras. It is 0
+    without CALIB_MIXED_PRECISION.
+    */
+    CV_EXPORTS_W double stereoCalibrate(InputOutputArrayOfArrays objectPoints, InputOutputArrayOfArrays imagePoints1, InputOutputArrayOfArrays imagePoints2,
+        const Size& imageSize1, const Size& imageSize2, InputOutputArray K1, InputOutputArray xi1, InputOutputArray D1, InputOutputArray K2, InputOutputArray xi2,
+        InputOutputArray D2, OutputArray rvec, OutputArray tvec, OutputArrayOfArrays rvecsL, OutputArrayOfArrays tvecsL, int flags, TermCriteria criteria, OutputArray idx,
+        CV_OUT double& mixedPrecisionStep);
+
+    /** @overload
+
+    @param Dinv1 Output closed form inverse of the distortion of the first camera, see fitInverseDistortion
+    @param Dinv2 Output closed form inverse of the distortion of the second camera
+    @param inverseError1 Output largest reprojection error in pixels of Dinv1 over imageSize1
+    @param inverseError2 Output largest reprojection error in pixels of Dinv2 over imageSize2
+    */
+    CV_EXPORTS_W double stereoCalibrate(InputOutputArrayOfArrays objectPoints, InputOutputArrayOfArrays imagePoints1, InputOutputArrayOfArrays imagePoints2,
+        const Size& imageSize1, const Size& imageSize2, InputOutputArray K1, InputOutputArray xi1, InputOutputArray D1, InputOutputArray K2, InputOutputArray xi2,
+        InputOutputArray D2, OutputArray rvec, OutputArray tvec, OutputArrayOfArrays rvecsL, OutputArrayOfArrays tvecsL, int flags, TermCriteria criteria, OutputArray idx,
+        OutputArray Dinv1, OutputArray Dinv2, CV_OUT double& inverseError1, CV_OUT double& inverseError2);
+
     /** @brief Stereo rectification for omnidirectional camera model. It computes the rectification rotations for two cameras
 
     @param R Rotation between the first and second camera
@@ -234,6 +1057,10 @@ namespace omnidir
     @param Knew New camera matrix of rectified image, see omnidir::undistortImage
     @param pointCloud Point cloud of 3D reconstruction, with type CV_64FC3
     @param pointType Point cloud type, it can be XYZRGB or XYZ
+
+    The disparity is zero at the pixels of the first rectified image that are black or outside the first camera,
+    as given by the mask of initUndistortRectifyMap, and the point cloud holds the pixels of disparity above 15
+    in column major order.
     */
     CV_EXPORTS_W void stereoReconstruct(InputArray image1, InputArray image2, InputArray K1, InputArray D1, InputArray xi1,
         InputArray K2, InputArray D2, InputArray xi2, InputArray R, InputArray T, int flag, int numDisparities, int SADWindowSize,
@@ -242,6 +1069,13 @@ namespace omnidir
 
 namespace internal
 {
+    /** @brief Same as omnidir::projectPoints, but the jacobian columns of parameters that are fixed by the
+    calibration flags (CALIB_FIX_SKEW, CALIB_FIX_XI, CALIB_FIX_K1 with CALIB_FIX_K2, CALIB_FIX_P1 with CALIB_FIX_P2)
+    are not computed and are set to zero.
+    */
+    void projectPoints(InputArray objectPoints, OutputArray imagePoints, InputArray rvec, InputArray tvec,
+        InputArray K, double xi, InputArray D, OutputArray jacobian, int flags);
+
     void initializeCalibration(InputArrayOfArrays objectPoints, InputArrayOfArrays imagePoints, Size size, OutputArrayOfArrays omAll,
         OutputArrayOfArrays tAll, OutputArray K, double& xi, OutputArray idx = noArray());
 
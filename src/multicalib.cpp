@@ -598,6 +598,11 @@ double MultiCameraCalibration::computeProjectError(Mat& parameters)
 
     float totalError = 0;
     int totalNPoints = 0;
+
+    // omnidirectional edges are gathered per camera and projected in one batch each
+    std::vector<std::vector<Mat> > objectPointsCamera(_nCamera), imagePointsCamera(_nCamera);
+    std::vector<std::vector<Vec3f> > rvecCamera(_nCamera), tvecCamera(_nCamera);
+
     for (int edgeIdx = 0; edgeIdx < nEdge; ++edgeIdx)
     {
         Mat RPhoto, RCamera, TPhoto, TCamera, transform;
@@ -643,10 +648,11 @@ double MultiCameraCalibration::computeProjectError(Mat& parameters)
         //}
         else if (this->_camType == OMNIDIRECTIONAL)
         {
-            float xi = _xi[cameraVertex].at<float>(0);
-
-            cv::omnidir::projectPoints(objectPoints, proImagePoints, rvec, tvec, _cameraMatrix[cameraVertex],
-                xi, _distortCoeffs[cameraVertex]);
+            objectPointsCamera[cameraVertex].push_back(objectPoints);
+            imagePointsCamera[cameraVertex].push_back(imagePoints);
+            rvecCamera[cameraVertex].push_back(Vec3f(rvec.ptr<float>()));
+            tvecCamera[cameraVertex].push_back(Vec3f(tvec.ptr<float>()));
+            continue;
         }
         Mat error = imagePoints - proImagePoints;
         Vec2f* ptr_err = error.ptr<Vec2f>();
@@ -656,6 +662,31 @@ double MultiCameraCalibration::computeProjectError(Mat& parameters)
         }
         totalNPoints += (int)error.total();
     }
+
+    for (int camIdx = 0; camIdx < (int)objectPointsCamera.size(); ++camIdx)
+    {
+        if (objectPointsCamera[camIdx].empty())
+            continue;
+        float xi = _xi[camIdx].at<float>(0);
+        Mat proImagePoints;
+        cv::omnidir::projectPointsBatch(objectPointsCamera[camIdx], proImagePoints, rvecCamera[camIdx], tvecCamera[camIdx],
+            _cameraMatrix[camIdx], xi, _distortCoeffs[camIdx]);
+
+        int nPointsAccu = 0;
+        for (int j = 0; j < (int)imagePointsCamera[camIdx].size(); ++j)
+        {
+            Mat imagePoints = imagePointsCamera[camIdx][j];
+            int nPoints = (int)imagePoints.total();
+            Mat error = imagePoints.reshape(2, 1) - proImagePoints.colRange(nPointsAccu, nPointsAccu + nPoints);
+            Vec2f* ptr_err = error.ptr<Vec2f>();
+            for (int i = 0; i < nPoints; ++i)
+            {
+                totalError += sqrt(ptr_err[i][0]*ptr_err[i][0] + ptr_err[i][1]*ptr_err[i][1]);
+            }
+            totalNPoints += nPoints;
+            nPointsAccu += nPoints;
+        }
+    }
     double meanReProjError = totalError / totalNPoints;
     _error = meanReProjError;
     return meanReProjError;
@@ -60,6 +60,22 @@
 #include "opencv2/ccalib/omnidir.hpp"
 #include <fstream>
 #include <iostream>
+#include <list>
+#include <cstdio>
+#include <cstddef>
+#include <limits>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <process.h>
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
 namespace cv { namespace
 {
     struct JacobianRow
@@ -71,472 +87,3854 @@ namespace cv { namespace
         double dxi;
         Matx14d dkp;    // distortion k1,k2,p1,p2
     };
+
+    // Broadcast and sqrt helpers, so that one kernel body serves plain scalars
+    // as well as the universal intrinsic types.
+    template<typename V> inline V lanesAll(double v);
+    template<> inline double lanesAll<double>(double v) { return v; }
+    template<> inline float lanesAll<float>(double v) { return (float)v; }
+    inline double lanesSqrt(double v) { return std::sqrt(v); }
+    inline float lanesSqrt(float v) { return std::sqrt(v); }
+#if CV_SIMD128
+    template<> inline v_float32x4 lanesAll<v_float32x4>(double v) { return v_setall_f32((float)v); }
+    inline v_float32x4 lanesSqrt(const v_float32x4& v) { return v_sqrt(v); }
+#endif
+#if CV_SIMD128_64F
+    template<> inline v_float64x2 lanesAll<v_float64x2>(double v) { return v_setall_f64(v); }
+    inline v_float64x2 lanesSqrt(const v_float64x2& v) { return v_sqrt(v); }
+#endif
+
+    // Pose and intrinsic parameters of one projectPoints call, parsed once from the InputArrays
+    struct ProjectionParams
+    {
+        Matx33d R;
+        Matx<double, 3, 9> dRdom;
+        Vec3d T;
+        Vec2d f, c;
+        double s, xi;
+        Vec4d kp;    // distortion k1,k2,p1,p2
+    };
+
+    // ProjectionParams, each broadcast to all lanes of V
+    template<typename V> struct ProjectionLanes
+    {
+        V r[9], t[3];
+        V fx, fy, s, cx, cy, xi, k1, k2, p1, p2;
+
+        explicit ProjectionLanes(const ProjectionParams& p)
+        {
+            for (int i = 0; i < 9; i++)
+                r[i] = lanesAll<V>(p.R.val[i]);
+            for (int i = 0; i < 3; i++)
+                t[i] = lanesAll<V>(p.T[i]);
+            fx = lanesAll<V>(p.f[0]); fy = lanesAll<V>(p.f[1]); s = lanesAll<V>(p.s);
+            cx = lanesAll<V>(p.c[0]); cy = lanesAll<V>(p.c[1]); xi = lanesAll<V>(p.xi);
+            k1 = lanesAll<V>(p.kp[0]); k2 = lanesAll<V>(p.kp[1]); p1 = lanesAll<V>(p.kp[2]); p2 = lanesAll<V>(p.kp[3]);
+        }
+    };
+
+    // The forward model of projectPoints, evaluated in the same order of operations
+    // as the scalar loop so that the lanes reproduce its results.
+    template<typename V> inline void projectLanes(const ProjectionLanes<V>& p, const V& X, const V& Y, const V& Z, V& u, V& v)
+    {
+        const V one = lanesAll<V>(1.0), two = lanesAll<V>(2.0);
+
+        // convert to camera coordinate
+        V Xc = p.r[0]*X + p.r[1]*Y + p.r[2]*Z + p.t[0];
+        V Yc = p.r[3]*X + p.r[4]*Y + p.r[5]*Z + p.t[1];
+        V Zc = p.r[6]*X + p.r[7]*Y + p.r[8]*Z + p.t[2];
+
+        // convert to unit sphere
+        V inorm = one / lanesSqrt(Xc*Xc + Yc*Yc + Zc*Zc);
+        V Xs = Xc*inorm, Ys = Yc*inorm, Zs = Zc*inorm;
+
+        // convert to normalized image plane
+        V xu = Xs / (Zs + p.xi), yu = Ys / (Zs + p.xi);
+
+        // add distortion
+        V r2 = xu*xu + yu*yu;
+        V r4 = r2*r2;
+        V radial = one + p.k1*r2 + p.k2*r4;
+        V xd = xu*radial + two*p.p1*xu*yu + p.p2*(r2 + two*xu*xu);
+        V yd = yu*radial + p.p1*(r2 + two*yu*yu) + two*p.p2*xu*yu;
+
+        // convert to pixel coordinate
+        u = p.fx*xd + p.s*yd + p.cx;
+        v = p.fy*yd + p.cy;
+    }
+
+    // Groups of jacobian columns that can be skipped when the corresponding parameters are fixed
+    enum
+    {
+        JAC_SKEW        = 1,    // s
+        JAC_XI          = 2,    // xi
+        JAC_RADIAL      = 4,    // k1, k2
+        JAC_TANGENTIAL  = 8,    // p1, p2
+        JAC_ALL         = 15
+    };
+
+    // Maps calibration flags to the JAC_* groups that still have to be computed
+    inline int flags2jacobian(int flags)
+    {
+        int live = JAC_ALL;
+        if (flags & omnidir::CALIB_FIX_SKEW)
+            live &= ~JAC_SKEW;
+        if (flags & omnidir::CALIB_FIX_XI)
+            live &= ~JAC_XI;
+        if ((flags & omnidir::CALIB_FIX_K1) && (flags & omnidir::CALIB_FIX_K2))
+            live &= ~JAC_RADIAL;
+        if ((flags & omnidir::CALIB_FIX_P1) && (flags & omnidir::CALIB_FIX_P2))
+            live &= ~JAC_TANGENTIAL;
+        return live;
+    }
+
+    // Projects one point and fills its two jacobian rows. Column groups that are not in LIVE
+    // are set to zero without being computed.
+    template<int LIVE> inline void projectPointJacobian(const ProjectionParams& p, const Vec3d& Xw, Vec2d& xp, JacobianRow* Jn)
+    {
+        const double xi = p.xi;
+        const double k1 = p.kp[0], k2 = p.kp[1], p1 = p.kp[2], p2 = p.kp[3];
+
+        // forward model, see projectLanes
+        Vec3d Xc = (Vec3d)(p.R*Xw + p.T);
+        double r_1 = 1.0/norm(Xc);
+        Vec3d Xs = Xc*r_1;
+        Vec2d xu = Vec2d(Xs[0]/(Xs[2]+xi), Xs[1]/(Xs[2]+xi));
+        double r2 = xu[0]*xu[0]+xu[1]*xu[1];
+        double r4 = r2*r2;
+        Vec2d xd;
+        xd[0] = xu[0]*(1+k1*r2+k2*r4) + 2*p1*xu[0]*xu[1] + p2*(r2+2*xu[0]*xu[0]);
+        xd[1] = xu[1]*(1+k1*r2+k2*r4) + p1*(r2+2*xu[1]*xu[1]) + 2*p2*xu[0]*xu[1];
+        xp[0] = p.f[0]*xd[0]+p.s*xd[1]+p.c[0];
+        xp[1] = p.f[1]*xd[1]+p.c[1];
+
+        // dXc/dom = dXc/dR * dR/dom, where dXc/dR only picks Xw for the row of R it multiplies
+        Matx33d dXcdom;
+        for (int r = 0; r < 3; r++)
+            for (int j = 0; j < 3; j++)
+                dXcdom(r, j) = p.dRdom(j, 3*r)*Xw[0] + p.dRdom(j, 3*r+1)*Xw[1] + p.dRdom(j, 3*r+2)*Xw[2];
+
+        double r_3 = r_1*r_1*r_1;
+        Matx33d dXsdXc(r_1-Xc[0]*Xc[0]*r_3, -(Xc[0]*Xc[1])*r_3, -(Xc[0]*Xc[2])*r_3,
+                       -(Xc[0]*Xc[1])*r_3, r_1-Xc[1]*Xc[1]*r_3, -(Xc[1]*Xc[2])*r_3,
+                       -(Xc[0]*Xc[2])*r_3, -(Xc[1]*Xc[2])*r_3, r_1-Xc[2]*Xc[2]*r_3);
+        double iz = 1.0/(Xs[2]+xi);
+        Matx21d dxudxi(-Xs[0]*iz*iz,
+                       -Xs[1]*iz*iz);
+        Matx23d dxudXs(iz, 0, dxudxi(0),
+                       0, iz, dxudxi(1));
+        double temp1 = 2*k1*xu[0] + 4*k2*xu[0]*r2;
+        double temp2 = 2*k1*xu[1] + 4*k2*xu[1]*r2;
+        Matx22d dxddxu(k2*r4+6*p2*xu[0]+2*p1*xu[1]+xu[0]*temp1+k1*r2+1,    2*p1*xu[0]+2*p2*xu[1]+xu[0]*temp2,
+                       2*p1*xu[0]+2*p2*xu[1]+xu[1]*temp1,    k2*r4+2*p2*xu[0]+6*p1*xu[1]+xu[1]*temp2+k1*r2+1);
+        Matx22d dxpddxd(p.f[0], p.s,
+                        0, p.f[1]);
+        Matx22d dxpddxu = dxpddxd * dxddxu;
+        Matx23d dxpddXc = dxpddxu * dxudXs * dXsdXc;
+
+        // derivative of xpd respect to om and T
+        Matx23d dxpddom = dxpddXc * dXcdom;
+        Jn[0].dom = dxpddom.row(0);
+        Jn[1].dom = dxpddom.row(1);
+        Jn[0].dT = dxpddXc.row(0);
+        Jn[1].dT = dxpddXc.row(1);
+
+        // derivative of xpd respect to f and c
+        Jn[0].df = Matx12d(xd[0], 0);
+        Jn[1].df = Matx12d(0, xd[1]);
+        Jn[0].dc = Matx12d(1, 0);
+        Jn[1].dc = Matx12d(0, 1);
+
+        // derivative of xpd respect to s
+        Jn[0].ds = (LIVE & JAC_SKEW) ? xd[1] : 0;
+        Jn[1].ds = 0;
+
+        // derivative of xpd respect to xi
+        if (LIVE & JAC_XI)
+        {
+            Matx21d dxpddxi = dxpddxu * dxudxi;
+            Jn[0].dxi = dxpddxi(0);
+            Jn[1].dxi = dxpddxi(1);
+        }
+        else
+        {
+            Jn[0].dxi = Jn[1].dxi = 0;
+        }
+
+        // derivative of xpd respect to kp, i.e. dxpd/dxd * dxd/dkp
+        Jn[0].dkp = Jn[1].dkp = Matx14d::zeros();
+        if (LIVE & JAC_RADIAL)
+        {
+            Jn[0].dkp(0) = (p.f[0]*xu[0] + p.s*xu[1])*r2;
+            Jn[0].dkp(1) = (p.f[0]*xu[0] + p.s*xu[1])*r4;
+            Jn[1].dkp(0) = p.f[1]*xu[1]*r2;
+            Jn[1].dkp(1) = p.f[1]*xu[1]*r4;
+        }
+        if (LIVE & JAC_TANGENTIAL)
+        {
+            double dxdp1 = 2*xu[0]*xu[1], dydp1 = r2+2*xu[1]*xu[1];
+            double dxdp2 = r2+2*xu[0]*xu[0], dydp2 = 2*xu[0]*xu[1];
+            Jn[0].dkp(2) = p.f[0]*dxdp1 + p.s*dydp1;
+            Jn[0].dkp(3) = p.f[0]*dxdp2 + p.s*dydp2;
+            Jn[1].dkp(2) = p.f[1]*dydp1;
+            Jn[1].dkp(3) = p.f[1]*dydp2;
+        }
+    }
+
+    template<int LIVE, typename Tp>
+    void projectPointsJacobianT(const ProjectionParams& p, const Vec<Tp, 3>* Xw, Vec<Tp, 2>* xp, JacobianRow* Jn, int n)
+    {
+        for (int i = 0; i < n; i++, Jn += 2)
+        {
+            Vec2d x;
+            projectPointJacobian<LIVE>(p, (Vec3d)Xw[i], x, Jn);
+            xp[i] = x;
+        }
+    }
+
+    // Picks the instantiation of the jacobian kernel for the given JAC_* groups
+    template<typename Tp>
+    void projectPointsJacobian(const ProjectionParams& p, const Vec<Tp, 3>* Xw, Vec<Tp, 2>* xp, JacobianRow* Jn, int n, int live)
+    {
+        typedef void (*ProjectJacobianFunc)(const ProjectionParams&, const Vec<Tp, 3>*, Vec<Tp, 2>*, JacobianRow*, int);
+        static const ProjectJacobianFunc funcs[JAC_ALL + 1] =
+        {
+            projectPointsJacobianT<0, Tp>,  projectPointsJacobianT<1, Tp>,  projectPointsJacobianT<2, Tp>,  projectPointsJacobianT<3, Tp>,
+            projectPointsJacobianT<4, Tp>,  projectPointsJacobianT<5, Tp>,  projectPointsJacobianT<6, Tp>,  projectPointsJacobianT<7, Tp>,
+            projectPointsJacobianT<8, Tp>,  projectPointsJacobianT<9, Tp>,  projectPointsJacobianT<10, Tp>, projectPointsJacobianT<11, Tp>,
+            projectPointsJacobianT<12, Tp>, projectPointsJacobianT<13, Tp>, projectPointsJacobianT<14, Tp>, projectPointsJacobianT<15, Tp>
+        };
+        CV_Assert(0 <= live && live <= JAC_ALL);
+        funcs[live](p, Xw, xp, Jn, n);
+    }
+
+    // Lists the jacobian columns that are computed for the JAC_* groups in live
+    inline int jacobianColumns(int live, int* cols)
+    {
+        int k = 0;
+        for (int j = 0; j < 16; j++)
+        {
+            bool fixed = (j == 8 && !(live & JAC_SKEW)) || (j == 11 && !(live & JAC_XI)) ||
+                ((j == 12 || j == 13) && !(live & JAC_RADIAL)) || ((j == 14 || j == 15) && !(live & JAC_TANGENTIAL));
+            if (!fixed)
+                cols[k++] = j;
+        }
+        return k;
+    }
+
+    // Adds the contribution of every point of a view to J^T*J and J^T*e, with J in the column
+    // order of JacobianRow and e = x - projection, without storing the jacobian itself.
+    template<int LIVE>
+    void accumulateNormalEquationsT(const ProjectionParams& p, const Vec3d* Xw, const Vec2d* x, int n,
+        Matx<double, 16, 16>& JtJ, Vec<double, 16>& JtE)
+    {
+        int cols[16];
+        int ncols = jacobianColumns(LIVE, cols);
+        for (int i = 0; i < n; i++)
+        {
+            JacobianRow Jn[2];
+            Vec2d xp;
+            projectPointJacobian<LIVE>(p, Xw[i], xp, Jn);
+            Vec2d e = x[i] - xp;
+            for (int r = 0; r < 2; r++)
+            {
+                const double* J = (const double*)&Jn[r];
+                for (int a = 0; a < ncols; a++)
+                {
+                    double Ja = J[cols[a]];
+                    JtE[cols[a]] += Ja*e[r];
+                    for (int b = a; b < ncols; b++)
+                        JtJ(cols[a], cols[b]) += Ja*J[cols[b]];
+                }
+            }
+        }
+        for (int a = 0; a < ncols; a++)
+            for (int b = a + 1; b < ncols; b++)
+                JtJ(cols[b], cols[a]) = JtJ(cols[a], cols[b]);
+    }
+
+    void accumulateNormalEquations(const ProjectionParams& p, const Vec3d* Xw, const Vec2d* x, int n, int live,
+        Matx<double, 16, 16>& JtJ, Vec<double, 16>& JtE)
+    {
+        typedef void (*AccumulateFunc)(const ProjectionParams&, const Vec3d*, const Vec2d*, int, Matx<double, 16, 16>&, Vec<double, 16>&);
+        static const AccumulateFunc funcs[JAC_ALL + 1] =
+        {
+            accumulateNormalEquationsT<0>,  accumulateNormalEquationsT<1>,  accumulateNormalEquationsT<2>,  accumulateNormalEquationsT<3>,
+            accumulateNormalEquationsT<4>,  accumulateNormalEquationsT<5>,  accumulateNormalEquationsT<6>,  accumulateNormalEquationsT<7>,
+            accumulateNormalEquationsT<8>,  accumulateNormalEquationsT<9>,  accumulateNormalEquationsT<10>, accumulateNormalEquationsT<11>,
+            accumulateNormalEquationsT<12>, accumulateNormalEquationsT<13>, accumulateNormalEquationsT<14>, accumulateNormalEquationsT<15>
+        };
+        CV_Assert(0 <= live && live <= JAC_ALL);
+        funcs[live](p, Xw, x, n, JtJ, JtE);
+    }
+
+    // ProjectionLanes together with dR/dom, for the mixed precision jacobian kernel
+    template<typename V> struct JacobianLanes : public ProjectionLanes<V>
+    {
+        V dRdom[27];
+
+        explicit JacobianLanes(const ProjectionParams& p) : ProjectionLanes<V>(p)
+        {
+            for (int i = 0; i < 27; i++)
+                dRdom[i] = lanesAll<V>(p.dRdom.val[i]);
+        }
+    };
+
+    // projectPointJacobian<JAC_ALL> in lanes of V. The two jacobian rows are returned in J0 and J1
+    // in the column order of JacobianRow; callers drop the columns of fixed parameters.
+    template<typename V> inline void projectJacobianLanes(const JacobianLanes<V>& p, const V& X, const V& Y, const V& Z,
+        V& u, V& v, V* J0, V* J1)
+    {
+        const V zero = lanesAll<V>(0.0), one = lanesAll<V>(1.0), two = lanesAll<V>(2.0);
+
+        // forward model, see projectLanes
+        V Xc = p.r[0]*X + p.r[1]*Y + p.r[2]*Z + p.t[0];
+        V Yc = p.r[3]*X + p.r[4]*Y + p.r[5]*Z + p.t[1];
+        V Zc = p.r[6]*X + p.r[7]*Y + p.r[8]*Z + p.t[2];
+        V r_1 = one / lanesSqrt(Xc*Xc + Yc*Yc + Zc*Zc);
+        V iz = one / (Zc*r_1 + p.xi);
+        V xu = Xc*r_1*iz, yu = Yc*r_1*iz;
+        V xuyu = xu*yu, xu2 = xu*xu, yu2 = yu*yu;
+        V r2 = xu2 + yu2, r4 = r2*r2;
+        V radial = one + p.k1*r2 + p.k2*r4;
+        V dxdp1 = two*xuyu, dydp1 = r2 + two*yu2;
+        V dxdp2 = r2 + two*xu2, dydp2 = two*xuyu;
+        V xd = xu*radial + p.p1*dxdp1 + p.p2*dxdp2;
+        V yd = yu*radial + p.p1*dydp1 + p.p2*dydp2;
+        u = p.fx*xd + p.s*yd + p.cx;
+        v = p.fy*yd + p.cy;
+
+        // dxd/dxu
+        V dradial = two*p.k1 + lanesAll<V>(4.0)*p.k2*r2;
+        V a00 = radial + lanesAll<V>(6.0)*p.p2*xu + two*p.p1*yu + xu2*dradial;
+        V a01 = two*p.p1*xu + two*p.p2*yu + xuyu*dradial;
+        V a11 = radial + two*p.p2*xu + lanesAll<V>(6.0)*p.p1*yu + yu2*dradial;
+
+        // dxp/dxu = dxp/dxd * dxd/dxu
+        V b00 = p.fx*a00 + p.s*a01, b01 = p.fx*a01 + p.s*a11;
+        V b10 = p.fy*a01, b11 = p.fy*a11;
+
+        // dxp/dXs, its last column is dxp/dxi as well
+        V c00 = b00*iz, c01 = b01*iz, c02 = zero - (b00*xu + b01*yu)*iz;
+        V c10 = b10*iz, c11 = b11*iz, c12 = zero - (b10*xu + b11*yu)*iz;
+
+        // dxp/dT = dxp/dXc = dxp/dXs * (I/|Xc| - Xc*Xc^T/|Xc|^3)
+        V r_3 = r_1*r_1*r_1;
+        V dot0 = (c00*Xc + c01*Yc + c02*Zc)*r_3, dot1 = (c10*Xc + c11*Yc + c12*Zc)*r_3;
+        J0[3] = c00*r_1 - Xc*dot0; J0[4] = c01*r_1 - Yc*dot0; J0[5] = c02*r_1 - Zc*dot0;
+        J1[3] = c10*r_1 - Xc*dot1; J1[4] = c11*r_1 - Yc*dot1; J1[5] = c12*r_1 - Zc*dot1;
+
+        // dxp/dom = dxp/dXc * dXc/dom
+        for (int j = 0; j < 3; j++)
+        {
+            const V* d = p.dRdom + 9*j;
+            V dXc = d[0]*X + d[1]*Y + d[2]*Z;
+            V dYc = d[3]*X + d[4]*Y + d[5]*Z;
+            V dZc = d[6]*X + d[7]*Y + d[8]*Z;
+            J0[j] = J0[3]*dXc + J0[4]*dYc + J0[5]*dZc;
+            J1[j] = J1[3]*dXc + J1[4]*dYc + J1[5]*dZc;
+        }
+
+        // f, s, c and xi
+        J0[6] = xd;   J0[7] = zero; J0[8] = yd;   J0[9] = one;  J0[10] = zero; J0[11] = c02;
+        J1[6] = zero; J1[7] = yd;   J1[8] = zero; J1[9] = zero; J1[10] = one;  J1[11] = c12;
+
+        // k1, k2, p1, p2
+        V fxs = p.fx*xu + p.s*yu, fyy = p.fy*yu;
+        J0[12] = fxs*r2; J0[13] = fxs*r4; J0[14] = p.fx*dxdp1 + p.s*dydp1; J0[15] = p.fx*dxdp2 + p.s*dydp2;
+        J1[12] = fyy*r2; J1[13] = fyy*r4; J1[14] = p.fy*dydp1;             J1[15] = p.fy*dydp2;
+    }
+
+#if CV_SIMD128_64F
+    inline void loadPointsF32(const float* X, v_float32x4& x, v_float32x4& y, v_float32x4& z)
+    {
+        v_load_deinterleave(X, x, y, z);
+    }
+
+    inline void loadPointsF32(const double* X, v_float32x4& x, v_float32x4& y, v_float32x4& z)
+    {
+        v_float64x2 x0, y0, z0, x1, y1, z1;
+        v_load_deinterleave(X, x0, y0, z0);
+        v_load_deinterleave(X + 6, x1, y1, z1);
+        x = v_cvt_f32(x0, x1);
+        y = v_cvt_f32(y0, y1);
+        z = v_cvt_f32(z0, z1);
+    }
+
+    inline double lanesSum(const v_float64x2& v)
+    {
+        double buf[2];
+        v_store(buf, v);
+        return buf[0] + buf[1];
+    }
+#endif
+
+    // Mixed precision projectPointsJacobian: projection and jacobian are evaluated in float,
+    // four points at a time when SIMD is available, and stored as double.
+    template<typename Tp>
+    void projectPointsJacobianF32(const ProjectionParams& p, const Vec<Tp, 3>* Xw, Vec<Tp, 2>* xp, JacobianRow* Jn, int n, int live)
+    {
+        int cols[16];
+        int ncols = jacobianColumns(live, cols);
+        std::fill((double*)Jn, (double*)(Jn + 2*n), 0.0);
+
+        int i = 0;
+#if CV_SIMD128_64F
+        if (hasSIMD128())
+        {
+            JacobianLanes<v_float32x4> lanes(p);
+            for (; i <= n - 4; i += 4)
+            {
+                v_float32x4 X, Y, Z, u, v, J[2][16];
+                loadPointsF32((const Tp*)(Xw + i), X, Y, Z);
+                projectJacobianLanes(lanes, X, Y, Z, u, v, J[0], J[1]);
+
+                float ubuf[4], vbuf[4], Jbuf[2][16][4];
+                v_store(ubuf, u);
+                v_store(vbuf, v);
+                for (int r = 0; r < 2; r++)
+                    for (int a = 0; a < ncols; a++)
+                        v_store(Jbuf[r][cols[a]], J[r][cols[a]]);
+                for (int k = 0; k < 4; k++)
+                {
+                    xp[i + k] = Vec2d(ubuf[k], vbuf[k]);
+                    for (int r = 0; r < 2; r++)
+                    {
+                        double* Jd = (double*)&Jn[2*(i + k) + r];
+                        for (int a = 0; a < ncols; a++)
+                            Jd[cols[a]] = Jbuf[r][cols[a]][k];
+                    }
+                }
+            }
+        }
+#endif
+
+        JacobianLanes<float> lanes(p);
+        for (; i < n; i++)
+        {
+            float u, v, J[2][16];
+            projectJacobianLanes(lanes, (float)Xw[i][0], (float)Xw[i][1], (float)Xw[i][2], u, v, J[0], J[1]);
+            xp[i] = Vec2d(u, v);
+            for (int r = 0; r < 2; r++)
+            {
+                double* Jd = (double*)&Jn[2*i + r];
+                for (int a = 0; a < ncols; a++)
+                    Jd[cols[a]] = J[r][cols[a]];
+            }
+        }
+    }
+
+    // Mixed precision accumulateNormalEquations: the projection and the jacobian are evaluated in
+    // float, the products of two jacobian columns are summed over points in double. The residuals
+    // are taken in double from the float projection.
+    void accumulateNormalEquationsF32(const ProjectionParams& p, const Vec3d* Xw, const Vec2d* x, int n, int live,
+        Matx<double, 16, 16>& JtJ, Vec<double, 16>& JtE)
+    {
+        int cols[16];
+        int ncols = jacobianColumns(live, cols);
+
+        int i = 0;
+#if CV_SIMD128_64F
+        if (hasSIMD128())
+        {
+            JacobianLanes<v_float32x4> lanes(p);
+            v_float64x2 accJtJ[16][16], accJtE[16];
+            for (int a = 0; a < ncols; a++)
+            {
+                accJtE[a] = v_setzero_f64();
+                for (int b = a; b < ncols; b++)
+                    accJtJ[a][b] = v_setzero_f64();
+            }
+
+            for (; i <= n - 4; i += 4)
+            {
+                v_float32x4 X, Y, Z, u, v, J0[16], J1[16];
+                loadPointsF32((const double*)(Xw + i), X, Y, Z);
+                projectJacobianLanes(lanes, X, Y, Z, u, v, J0, J1);
+
+                v_float64x2 x0, y0, x1, y1;
+                v_load_deinterleave((const double*)(x + i), x0, y0);
+                v_load_deinterleave((const double*)(x + i) + 4, x1, y1);
+                v_float64x2 eu0 = x0 - v_cvt_f64(u), eu1 = x1 - v_cvt_f64_high(u);
+                v_float64x2 ev0 = y0 - v_cvt_f64(v), ev1 = y1 - v_cvt_f64_high(v);
+
+                for (int a = 0; a < ncols; a++)
+                {
+                    const v_float32x4& Ja0 = J0[cols[a]];
+                    const v_float32x4& Ja1 = J1[cols[a]];
+                    accJtE[a] += v_cvt_f64(Ja0)*eu0 + v_cvt_f64_high(Ja0)*eu1 + v_cvt_f64(Ja1)*ev0 + v_cvt_f64_high(Ja1)*ev1;
+                    for (int b = a; b < ncols; b++)
+                    {
+                        v_float32x4 JaJb = Ja0*J0[cols[b]] + Ja1*J1[cols[b]];
+                        accJtJ[a][b] += v_cvt_f64(JaJb) + v_cvt_f64_high(JaJb);
+                    }
+                }
+            }
+
+            for (int a = 0; a < ncols; a++)
+            {
+                JtE[cols[a]] += lanesSum(accJtE[a]);
+                for (int b = a; b < ncols; b++)
+                    JtJ(cols[a], cols[b]) += lanesSum(accJtJ[a][b]);
+            }
+        }
+#endif
+
+        JacobianLanes<float> lanes(p);
+        for (; i < n; i++)
+        {
+            float u, v, J0[16], J1[16];
+            projectJacobianLanes(lanes, (float)Xw[i][0], (float)Xw[i][1], (float)Xw[i][2], u, v, J0, J1);
+            double eu = x[i][0] - u, ev = x[i][1] - v;
+            for (int a = 0; a < ncols; a++)
+            {
+                float Ja0 = J0[cols[a]], Ja1 = J1[cols[a]];
+                JtE[cols[a]] += Ja0*eu + Ja1*ev;
+                for (int b = a; b < ncols; b++)
+                    JtJ(cols[a], cols[b]) += (double)(Ja0*J0[cols[b]] + Ja1*J1[cols[b]]);
+            }
+        }
+
+        for (int a = 0; a < ncols; a++)
+            for (int b = a + 1; b < ncols; b++)
+                JtJ(cols[b], cols[a]) = JtJ(cols[a], cols[b]);
+    }
+
+#if CV_SIMD128_64F
+    // Vectorized projectPoints without jacobian. Points are processed four per iteration
+    // in double lanes; the number of processed points is returned and the tail is left to
+    // the scalar loop.
+    inline int projectPointsSIMD(const ProjectionLanes<v_float64x2>& p, const double* X, double* x, int n)
+    {
+        int i = 0;
+        for (; i <= n - 4; i += 4, X += 12, x += 8)
+        {
+            v_float64x2 X0, Y0, Z0, X1, Y1, Z1, u0, v0, u1, v1;
+            v_load_deinterleave(X, X0, Y0, Z0);
+            v_load_deinterleave(X + 6, X1, Y1, Z1);
+            projectLanes(p, X0, Y0, Z0, u0, v0);
+            projectLanes(p, X1, Y1, Z1, u1, v1);
+            v_store_interleave(x, u0, v0);
+            v_store_interleave(x + 4, u1, v1);
+        }
+        return i;
+    }
+
+    // Float points are widened to double lanes, so the only difference to the scalar
+    // path is the final rounding to float.
+    inline int projectPointsSIMD(const ProjectionLanes<v_float64x2>& p, const float* X, float* x, int n)
+    {
+        int i = 0;
+        for (; i <= n - 4; i += 4, X += 12, x += 8)
+        {
+            v_float32x4 Xf, Yf, Zf;
+            v_float64x2 u0, v0, u1, v1;
+            v_load_deinterleave(X, Xf, Yf, Zf);
+            projectLanes(p, v_cvt_f64(Xf), v_cvt_f64(Yf), v_cvt_f64(Zf), u0, v0);
+            projectLanes(p, v_cvt_f64_high(Xf), v_cvt_f64_high(Yf), v_cvt_f64_high(Zf), u1, v1);
+            v_store_interleave(x, v_cvt_f32(u0, u1), v_cvt_f32(v0, v1));
+        }
+        return i;
+    }
+#endif
+
+    // Projects points without jacobian: the bulk goes through the vectorized kernel and the
+    // tail through the scalar one.
+    template<typename Tp>
+    void projectPointsNoJacobian(const ProjectionParams& p, const Vec<Tp, 3>* Xw, Vec<Tp, 2>* xp, int n)
+    {
+        int i0 = 0;
+#if CV_SIMD128_64F
+        if (hasSIMD128())
+            i0 = projectPointsSIMD(ProjectionLanes<v_float64x2>(p), (const Tp*)Xw, (Tp*)xp, n);
+#endif
+
+        ProjectionLanes<double> lanes(p);
+        for (int i = i0; i < n; i++)
+        {
+            Vec2d final;
+            projectLanes(lanes, (double)Xw[i][0], (double)Xw[i][1], (double)Xw[i][2], final[0], final[1]);
+            xp[i] = final;
+        }
+    }
+
+    // Removes the k1, k2, p1, p2 distortion from a point of the normalized plane by Newton's method
+    // on the 2x2 jacobian of the distortion, starting from the initial guess in pu. Stops after maxCount
+    // steps or once a step is not longer than eps, and returns the number of steps taken. When eps is not 0
+    // and no step got under it, pu is set to NaN.
+    inline int undistortNewton(const Vec2d& pp, const Vec4d& kp, int maxCount, double eps, Vec2d& pu)
+    {
+        const double k1 = kp[0], k2 = kp[1], p1 = kp[2], p2 = kp[3];
+        int iter = 0;
+        bool converged = false;
+        while (iter < maxCount)
+        {
+            double xu = pu[0], yu = pu[1];
+            double xuyu = xu*yu, xu2 = xu*xu, yu2 = yu*yu;
+            double r2 = xu2 + yu2;
+            double radial = 1 + k1*r2 + k2*r2*r2;
+            double dradial = 2*k1 + 4*k2*r2;
+
+            // residual of the distortion model and its jacobian, which is symmetric
+            double ex = xu*radial + 2*p1*xuyu + p2*(r2 + 2*xu2) - pp[0];
+            double ey = yu*radial + p1*(r2 + 2*yu2) + 2*p2*xuyu - pp[1];
+            double a00 = radial + 6*p2*xu + 2*p1*yu + xu2*dradial;
+            double a01 = 2*p1*xu + 2*p2*yu + xuyu*dradial;
+            double a11 = radial + 2*p2*xu + 6*p1*yu + yu2*dradial;
+            double det = a00*a11 - a01*a01;
+            if (!(std::abs(det) > 0))
+                break;
+
+            double dx = (a11*ex - a01*ey)/det, dy = (a00*ey - a01*ex)/det;
+            pu[0] -= dx;
+            pu[1] -= dy;
+            ++iter;
+            if (dx*dx + dy*dy <= eps*eps)
+            {
+                converged = true;
+                break;
+            }
+        }
+        if (eps > 0 && maxCount > 0 && !converged)
+            pu = Vec2d::all(std::numeric_limits<double>::quiet_NaN());
+        return iter;
+    }
+
+    // Newton steps that follow the closed form inverse of fitInverseDistortion
+    const int INVERSE_NEWTON_STEPS = 2;
+
+    // The closed form inverse of fitInverseDistortion, radial terms b1..b4 and tangential terms q1, q2 in the
+    // distorted normalized plane
+    inline Vec2d inverseDistortion(const Vec2d& pp, const Vec6d& kinv)
+    {
+        double x = pp[0], y = pp[1];
+        double r2 = x*x + y*y;
+        double radial = 1 + r2*(kinv[0] + r2*(kinv[1] + r2*(kinv[2] + r2*kinv[3])));
+        return Vec2d(x*radial + 2*kinv[4]*x*y + kinv[5]*(r2 + 2*x*x), y*radial + kinv[4]*(r2 + 2*y*y) + 2*kinv[5]*x*y);
+    }
+
+    // Parameters of undistortPoints and friends, parsed once from the InputArrays
+    struct UndistortParams
+    {
+        Vec2d f, c;
+        double s, xi;
+        Vec4d kp;    // distortion k1,k2,p1,p2
+        Matx33d R;
+        int maxCount;    // Newton iterations
+        double eps;
+        bool inverse;    // Newton starts from inverseDistortion with kinv
+        Vec6d kinv;
+    };
+
+    // R is either empty, a rotation vector or a 3x3 matrix
+    void getRotation(InputArray R, Matx33d& RR)
+    {
+        CV_Assert(R.empty() || (!R.empty() && (R.size() == Size(3, 3) || R.total() * R.channels() == 3)
+            && (R.depth() == CV_64F || R.depth() == CV_32F)));
+
+        RR = Matx33d::eye();
+        // R is om
+        if(!R.empty() && R.total()*R.channels() == 3)
+        {
+            cv::Vec3d rvec;
+            R.getMat().convertTo(rvec, CV_64F);
+            cv::Rodrigues(rvec, RR);
+        }
+        else if (!R.empty() && R.size() == Size(3,3))
+        {
+            R.getMat().convertTo(RR, CV_64F);
+        }
+    }
+
+    void getUndistortParams(InputArray K, InputArray D, InputArray xi, InputArray R, const TermCriteria& criteria,
+        UndistortParams& u)
+    {
+        CV_Assert((D.depth() == CV_64F || D.depth() == CV_32F) && D.total() == 4);
+        CV_Assert(K.size() == Size(3, 3) && (K.depth() == CV_64F || K.depth() == CV_32F));
+        CV_Assert(xi.total() == 1 && (xi.depth() == CV_64F || xi.depth() == CV_32F));
+
+        if (K.depth() == CV_32F)
+        {
+            Matx33f camMat = K.getMat();
+            u.f = Vec2f(camMat(0,0), camMat(1,1));
+            u.c = Vec2f(camMat(0,2), camMat(1,2));
+            u.s = (double)camMat(0,1);
+        }
+        else
+        {
+            Matx33d camMat = K.getMat();
+            u.f = Vec2d(camMat(0,0), camMat(1,1));
+            u.c = Vec2d(camMat(0,2), camMat(1,2));
+            u.s = camMat(0,1);
+        }
+
+        u.kp = D.depth()==CV_32F ? (Vec4d)*D.getMat().ptr<Vec4f>():(Vec4d)*D.getMat().ptr<Vec4d>();
+        u.xi = xi.depth() == CV_32F ? (double)*xi.getMat().ptr<float>() : *xi.getMat().ptr<double>();
+        getRotation(R, u.R);
+
+        u.maxCount = (criteria.type & TermCriteria::COUNT) ? criteria.maxCount : 100;
+        u.eps = (criteria.type & TermCriteria::EPS) ? criteria.epsilon : 0;
+        CV_Assert(u.maxCount >= 0 && u.eps >= 0);
+        u.inverse = false;
+    }
+
+    // Replaces the Newton iterations of u by the closed form inverse Dinv and a fixed number of steps
+    void setInverseDistortion(InputArray Dinv, UndistortParams& u)
+    {
+        CV_Assert(Dinv.total() == 6 && (Dinv.depth() == CV_64F || Dinv.depth() == CV_32F));
+        Mat kinv;
+        Dinv.getMat().reshape(1, 1).convertTo(kinv, CV_64F);
+        u.kinv = Vec6d(kinv.ptr<double>());
+        u.inverse = true;
+        u.maxCount = INVERSE_NEWTON_STEPS;
+        u.eps = 0;
+    }
+
+    // Lifts a point of the normalized plane to the unit sphere, the inverse of Xs/(Zs+xi)
+    inline Vec3d liftToSphere(const Vec2d& pu, double xi)
+    {
+        double r2 = pu[0]*pu[0] + pu[1]*pu[1];
+        double a = (r2 + 1);
+        double b = 2*xi*r2;
+        double cc = r2*xi*xi-1;
+        double Zs = (-b + sqrt(b*b - 4*a*cc))/(2*a);
+        return Vec3d(pu[0]*(Zs + xi), pu[1]*(Zs + xi), Zs);
+    }
+
+    // Maps an image point to the unit sphere of the camera, before the rotation R
+    inline Vec3d liftPixel(const UndistortParams& u, const Vec2d& pi, int& iter)
+    {
+        const Vec2d& f = u.f;
+        const Vec2d& c = u.c;
+        Vec2d pp((pi[0]*f[1]-c[0]*f[1]-u.s*(pi[1]-c[1]))/(f[0]*f[1]), (pi[1]-c[1])/f[1]); //plane
+        Vec2d pu = u.inverse ? inverseDistortion(pp, u.kinv) : pp;    // points without distortion
+        iter = undistortNewton(pp, u.kp, u.maxCount, u.eps, pu);
+        return liftToSphere(pu, u.xi);
+    }
+
+#if CV_SIMD128_64F
+    // UndistortParams, each broadcast to both double lanes
+    struct UndistortLanes
+    {
+        v_float64x2 fx, fy, cx, cy, s, xi, k1, k2, p1, p2, r[9];
+        v_float64x2 eps2;
+        int maxCount;
+        bool checkConvergence;    // the points that do not converge are set to NaN, see undistortNewton
+        bool inverse;
+        v_float64x2 kinv[6];
+
+        explicit UndistortLanes(const UndistortParams& u)
+        {
+            fx = v_setall_f64(u.f[0]); fy = v_setall_f64(u.f[1]);
+            cx = v_setall_f64(u.c[0]); cy = v_setall_f64(u.c[1]);
+            s = v_setall_f64(u.s); xi = v_setall_f64(u.xi);
+            k1 = v_setall_f64(u.kp[0]); k2 = v_setall_f64(u.kp[1]); p1 = v_setall_f64(u.kp[2]); p2 = v_setall_f64(u.kp[3]);
+            for (int i = 0; i < 9; i++)
+                r[i] = v_setall_f64(u.R.val[i]);
+            eps2 = v_setall_f64(u.eps*u.eps);
+            maxCount = u.maxCount;
+            checkConvergence = u.eps > 0 && u.maxCount > 0;
+            inverse = u.inverse;
+            for (int i = 0; i < 6; i++)
+                kinv[i] = v_setall_f64(u.kinv[i]);
+        }
+    };
+
+    // liftPixel and the rotation R for two points: the plane, the Newton iterations of undistortNewton and
+    // the lift of liftToSphere, in the same order of operations as the scalar code so that the results agree.
+    // Lanes stop iterating once they have converged, as in the scalar code.
+    inline void liftLanes(const UndistortLanes& u, const v_float64x2& px, const v_float64x2& py,
+        v_float64x2& Xw, v_float64x2& Yw, v_float64x2& Zw, v_float64x2& iters)
+    {
+        const v_float64x2 zero = v_setzero_f64(), one = v_setall_f64(1.0), two = v_setall_f64(2.0);
+        const v_float64x2 four = v_setall_f64(4.0), six = v_setall_f64(6.0);
+
+        // plane
+        v_float64x2 ppx = (px*u.fy - u.cx*u.fy - u.s*(py - u.cy))/(u.fx*u.fy);
+        v_float64x2 ppy = (py - u.cy)/u.fy;
+
+        // remove distortion
+        v_float64x2 xu = ppx, yu = ppy;
+        if (u.inverse)
+        {
+            v_float64x2 r2 = ppx*ppx + ppy*ppy;
+            v_float64x2 radial = one + r2*(u.kinv[0] + r2*(u.kinv[1] + r2*(u.kinv[2] + r2*u.kinv[3])));
+            xu = ppx*radial + two*u.kinv[4]*ppx*ppy + u.kinv[5]*(r2 + two*ppx*ppx);
+            yu = ppy*radial + u.kinv[4]*(r2 + two*ppy*ppy) + two*u.kinv[5]*ppx*ppy;
+        }
+        v_float64x2 active = one == one, converged = one != one;
+        iters = zero;
+        for (int iter = 0; iter < u.maxCount && v_check_any(active); iter++)
+        {
+            v_float64x2 xuyu = xu*yu, xu2 = xu*xu, yu2 = yu*yu;
+            v_float64x2 r2 = xu2 + yu2;
+            v_float64x2 radial = one + u.k1*r2 + u.k2*r2*r2;
+            v_float64x2 dradial = two*u.k1 + four*u.k2*r2;
+
+            v_float64x2 ex = xu*radial + two*u.p1*xuyu + u.p2*(r2 + two*xu2) - ppx;
+            v_float64x2 ey = yu*radial + u.p1*(r2 + two*yu2) + two*u.p2*xuyu - ppy;
+            v_float64x2 a00 = radial + six*u.p2*xu + two*u.p1*yu + xu2*dradial;
+            v_float64x2 a01 = two*u.p1*xu + two*u.p2*yu + xuyu*dradial;
+            v_float64x2 a11 = radial + two*u.p2*xu + six*u.p1*yu + yu2*dradial;
+            v_float64x2 det = a00*a11 - a01*a01;
+            active = active & (v_abs(det) > zero);
+
+            v_float64x2 dx = ((a11*ex - a01*ey)/det) & active, dy = ((a00*ey - a01*ex)/det) & active;
+            xu = xu - dx;
+            yu = yu - dy;
+            iters = iters + (one & active);
+            converged = converged | (active & (dx*dx + dy*dy <= u.eps2));
+            active = active & (dx*dx + dy*dy > u.eps2);
+        }
+        if (u.checkConvergence)
+        {
+            v_float64x2 nan = v_setall_f64(std::numeric_limits<double>::quiet_NaN());
+            xu = (xu & converged) | (nan & ~converged);
+            yu = (yu & converged) | (nan & ~converged);
+        }
+
+        // project to unit sphere
+        v_float64x2 r2 = xu*xu + yu*yu;
+        v_float64x2 a = r2 + one;
+        v_float64x2 b = two*u.xi*r2;
+        v_float64x2 cc = r2*u.xi*u.xi - one;
+        v_float64x2 Zs = (v_sqrt(b*b - four*a*cc) - b)/(two*a);
+        v_float64x2 Xs = xu*(Zs + u.xi), Ys = yu*(Zs + u.xi);
+
+        // rotate
+        Xw = u.r[0]*Xs + u.r[1]*Ys + u.r[2]*Zs;
+        Yw = u.r[3]*Xs + u.r[4]*Ys + u.r[5]*Zs;
+        Zw = u.r[6]*Xs + u.r[7]*Ys + u.r[8]*Zs;
+    }
+
+    // The loop of undistortPoints for two points
+    inline void undistortLanes(const UndistortLanes& u, const v_float64x2& px, const v_float64x2& py,
+        v_float64x2& ux, v_float64x2& uy, v_float64x2& iters)
+    {
+        v_float64x2 Xw, Yw, Zw;
+        liftLanes(u, px, py, Xw, Yw, Zw, iters);
+
+        // project back to sphere
+        v_float64x2 inorm = v_setall_f64(1.0) / v_sqrt(Xw*Xw + Yw*Yw + Zw*Zw);
+        Xw = Xw*inorm; Yw = Yw*inorm; Zw = Zw*inorm;
+
+        // reproject to camera plane
+        ux = Xw/(Zw + u.xi);
+        uy = Yw/(Zw + u.xi);
+    }
+
+    inline void storeIterations(int* iters, const v_float64x2& it)
+    {
+        double buf[2];
+        v_store(buf, it);
+        iters[0] = (int)buf[0];
+        iters[1] = (int)buf[1];
+    }
+
+    // Vectorized undistortPoints of points [i, n), two per lane group. Returns the first point left to the scalar loop.
+    inline int undistortPointsSIMD(const UndistortLanes& u, const double* src, double* dst, int* iters, int i, int n)
+    {
+        for (; i <= n - 2; i += 2)
+        {
+            v_float64x2 px, py, ux, uy, it;
+            v_load_deinterleave(src + 2*i, px, py);
+            undistortLanes(u, px, py, ux, uy, it);
+            v_store_interleave(dst + 2*i, ux, uy);
+            if (iters)
+                storeIterations(iters + i, it);
+        }
+        return i;
+    }
+
+    inline int undistortPointsSIMD(const UndistortLanes& u, const float* src, float* dst, int* iters, int i, int n)
+    {
+        for (; i <= n - 4; i += 4)
+        {
+            v_float32x4 px, py;
+            v_float64x2 ux0, uy0, ux1, uy1, it0, it1;
+            v_load_deinterleave(src + 2*i, px, py);
+            undistortLanes(u, v_cvt_f64(px), v_cvt_f64(py), ux0, uy0, it0);
+            undistortLanes(u, v_cvt_f64_high(px), v_cvt_f64_high(py), ux1, uy1, it1);
+            v_store_interleave(dst + 2*i, v_cvt_f32(ux0, ux1), v_cvt_f32(uy0, uy1));
+            if (iters)
+            {
+                storeIterations(iters + i, it0);
+                storeIterations(iters + i + 2, it1);
+            }
+        }
+        return i;
+    }
+
+    // Vectorized unprojectToSphere of points [i, n), see undistortPointsSIMD
+    inline int unprojectToSphereSIMD(const UndistortLanes& u, const double* src, double* dst, int i, int n)
+    {
+        for (; i <= n - 2; i += 2)
+        {
+            v_float64x2 px, py, Xw, Yw, Zw, it;
+            v_load_deinterleave(src + 2*i, px, py);
+            liftLanes(u, px, py, Xw, Yw, Zw, it);
+            v_store_interleave(dst + 3*i, Xw, Yw, Zw);
+        }
+        return i;
+    }
+
+    inline int unprojectToSphereSIMD(const UndistortLanes& u, const float* src, float* dst, int i, int n)
+    {
+        for (; i <= n - 4; i += 4)
+        {
+            v_float32x4 px, py;
+            v_float64x2 Xw0, Yw0, Zw0, Xw1, Yw1, Zw1, it;
+            v_load_deinterleave(src + 2*i, px, py);
+            liftLanes(u, v_cvt_f64(px), v_cvt_f64(py), Xw0, Yw0, Zw0, it);
+            liftLanes(u, v_cvt_f64_high(px), v_cvt_f64_high(py), Xw1, Yw1, Zw1, it);
+            v_store_interleave(dst + 3*i, v_cvt_f32(Xw0, Xw1), v_cvt_f32(Yw0, Yw1), v_cvt_f32(Zw0, Zw1));
+        }
+        return i;
+    }
+#endif
+
+    // undistortPoints of a range of points. For a 3-channel dst the rotated unit sphere points are
+    // written instead, as in unprojectToSphere.
+    class UndistortPointsInvoker : public ParallelLoopBody
+    {
+    public:
+        UndistortPointsInvoker(const UndistortParams& _u, const Mat& _src, Mat& _dst, int* _iters)
+            : u(_u), src(_src), dst(_dst), iters(_iters)
+        {
+        }
+
+        virtual void operator()(const Range& range) const
+        {
+            if (dst.channels() == 3)
+            {
+                unprojectToSphere(range);
+                return;
+            }
+
+            const cv::Vec2d *srcd = src.ptr<cv::Vec2d>();
+            const cv::Vec2f *srcf = src.ptr<cv::Vec2f>();
+
+            cv::Vec2d *dstd = dst.ptr<cv::Vec2d>();
+            cv::Vec2f *dstf = dst.ptr<cv::Vec2f>();
+
+            int i = range.start;
+#if CV_SIMD128_64F
+            if (hasSIMD128())
+            {
+                UndistortLanes lanes(u);
+                if (src.depth() == CV_32F)
+                    i = undistortPointsSIMD(lanes, (const float*)srcf, (float*)dstf, iters, i, range.end);
+                else
+                    i = undistortPointsSIMD(lanes, (const double*)srcd, (double*)dstd, iters, i, range.end);
+            }
+#endif
+
+            for (; i < range.end; i++)
+            {
+                Vec2d pi = src.depth() == CV_32F ? (Vec2d)srcf[i]:(Vec2d)srcd[i];    // image point
+
+                // remove distortion and project to unit sphere
+                int iter;
+                Vec3d Xw = liftPixel(u, pi, iter);
+                if (iters)
+                    iters[i] = iter;
+
+                // rotate
+                Xw = u.R * Xw;
+
+                // project back to sphere
+                Vec3d Xs = Xw / cv::norm(Xw);
+
+                // reproject to camera plane
+                Vec3d ppu = Vec3d(Xs[0]/(Xs[2]+u.xi), Xs[1]/(Xs[2]+u.xi), 1.0);
+                if (dst.depth() == CV_32F)
+                {
+                    dstf[i] = Vec2f((float)ppu[0], (float)ppu[1]);
+                }
+                else if (dst.depth() == CV_64F)
+                {
+                    dstd[i] = Vec2d(ppu[0], ppu[1]);
+                }
+            }
+        }
+
+    private:
+        void unprojectToSphere(const Range& range) const
+        {
+            const cv::Vec2d *srcd = src.ptr<cv::Vec2d>();
+            const cv::Vec2f *srcf = src.ptr<cv::Vec2f>();
+
+            cv::Vec3d *dstd = dst.ptr<cv::Vec3d>();
+            cv::Vec3f *dstf = dst.ptr<cv::Vec3f>();
+
+            int i = range.start;
+#if CV_SIMD128_64F
+            if (hasSIMD128())
+            {
+                UndistortLanes lanes(u);
+                if (src.depth() == CV_32F)
+                    i = unprojectToSphereSIMD(lanes, (const float*)srcf, (float*)dstf, i, range.end);
+                else
+                    i = unprojectToSphereSIMD(lanes, (const double*)srcd, (double*)dstd, i, range.end);
+            }
+#endif
+
+            for (; i < range.end; i++)
+            {
+                Vec2d pi = src.depth() == CV_32F ? (Vec2d)srcf[i]:(Vec2d)srcd[i];    // image point
+
+                // the lift is on the unit sphere already and R keeps it there
+                int iter;
+                Vec3d Xs = u.R * liftPixel(u, pi, iter);
+                if (dst.depth() == CV_32F)
+                    dstf[i] = Xs;
+                else
+                    dstd[i] = Xs;
+            }
+        }
+
+        const UndistortParams& u;
+        const Mat& src;
+        Mat& dst;
+        int* iters;
+
+        UndistortPointsInvoker& operator=(const UndistortPointsInvoker&);
+    };
+
+    void getProjectionIntrinsics(InputArray K, double xi, InputArray D, ProjectionParams& p)
+    {
+        CV_Assert((K.type() == CV_64F || K.type() == CV_32F) && K.size() == Size(3,3));
+        CV_Assert((D.type() == CV_64F || D.type() == CV_32F) && D.total() == 4);
+
+        if (K.depth() == CV_32F)
+        {
+            Matx33f Kc = K.getMat();
+            p.f = Vec2f(Kc(0,0), Kc(1,1));
+            p.c = Vec2f(Kc(0,2),Kc(1,2));
+            p.s = (double)Kc(0,1);
+        }
+        else
+        {
+            Matx33d Kc = K.getMat();
+            p.f = Vec2d(Kc(0,0), Kc(1,1));
+            p.c = Vec2d(Kc(0,2),Kc(1,2));
+            p.s = Kc(0,1);
+        }
+
+        p.kp = D.depth() == CV_32F ? (Vec4d)*D.getMat().ptr<Vec4f>() : *D.getMat().ptr<Vec4d>();
+        p.xi = xi;
+    }
+
+    // Accepts vector<Vec3x>, vector<Mat> of 3-element vectors or a Mat with 3 values per row/element.
+    void getVec3dArray(InputArrayOfArrays src, std::vector<Vec3d>& dst)
+    {
+        if (src.kind() == _InputArray::STD_VECTOR_MAT)
+        {
+            int n = (int)src.total();
+            dst.resize(n);
+            for (int i = 0; i < n; ++i)
+            {
+                Mat m = src.getMat(i);
+                CV_Assert((m.depth() == CV_64F || m.depth() == CV_32F) && m.total() * m.channels() == 3);
+                m.reshape(1, 3).convertTo(Mat(3, 1, CV_64F, dst[i].val), CV_64F);
+            }
+        }
+        else
+        {
+            Mat m = src.getMat();
+            CV_Assert((m.depth() == CV_64F || m.depth() == CV_32F) && (m.total() * m.channels()) % 3 == 0);
+            int n = (int)(m.total() * m.channels() / 3);
+            dst.resize(n);
+            if (n > 0)
+                m.reshape(1, n).convertTo(Mat(n, 3, CV_64F, dst[0].val), CV_64F);
+        }
+    }
+
+    // Projects the points of each view under its own pose into a shared output, views
+    // [offsets[v], offsets[v+1]) of it. A single set of object points is shared by all views.
+    class ProjectPointsBatchInvoker : public ParallelLoopBody
+    {
+    public:
+        ProjectPointsBatchInvoker(const ProjectionParams& _intrinsics, const std::vector<Vec3d>& _oms,
+            const std::vector<Vec3d>& _Ts, const std::vector<Mat>& _objectPoints, const std::vector<int>& _offsets,
+            Mat& _imagePoints) : intrinsics(_intrinsics), oms(_oms), Ts(_Ts), objectPoints(_objectPoints),
+            offsets(_offsets), imagePoints(_imagePoints)
+        {
+        }
+
+        virtual void operator()(const Range& range) const
+        {
+            for (int v = range.start; v < range.end; ++v)
+            {
+                ProjectionParams p = intrinsics;
+                Rodrigues(oms[v], p.R);
+                p.T = Ts[v];
+
+                const Mat& X = objectPoints[objectPoints.size() == 1 ? 0 : v];
+                int n = offsets[v + 1] - offsets[v];
+                if (X.depth() == CV_32F)
+                    projectPointsNoJacobian(p, X.ptr<Vec3f>(), imagePoints.ptr<Vec2f>() + offsets[v], n);
+                else
+                    projectPointsNoJacobian(p, X.ptr<Vec3d>(), imagePoints.ptr<Vec2d>() + offsets[v], n);
+            }
+        }
+
+    private:
+        const ProjectionParams& intrinsics;
+        const std::vector<Vec3d>& oms;
+        const std::vector<Vec3d>& Ts;
+        const std::vector<Mat>& objectPoints;
+        const std::vector<int>& offsets;
+        Mat& imagePoints;
+
+        ProjectPointsBatchInvoker& operator=(const ProjectPointsBatchInvoker&);
+    };
+
+    // Parameters of initUndistortRectifyMap, parsed once from the InputArrays
+    struct RectifyParams
+    {
+        Vec2d f, c;
+        double s, xi;
+        Vec4d kp;    // distortion k1,k2,p1,p2
+        Matx33d iKR, iK, iR;
+        int flags;
+
+        // cos and sin of theta per column and of h per row, for RECTIFY_CYLINDRICAL and RECTIFY_LONGLATI when
+        // theta only depends on the column and h on the row, see setTrigTables
+        std::vector<double> cosTheta, sinTheta, cosH, sinH;
+    };
+
+    void getRectifyParams(InputArray K, InputArray D, InputArray xi, InputArray R, InputArray P, int flags,
+        RectifyParams& m)
+    {
+        CV_Assert((K.depth() == CV_32F || K.depth() == CV_64F) && (D.depth() == CV_32F || D.depth() == CV_64F));
+        CV_Assert(K.size() == Size(3, 3) && (D.empty() || D.total() == 4));
+        CV_Assert(P.empty()|| (P.depth() == CV_32F || P.depth() == CV_64F));
+        CV_Assert(P.empty() || P.size() == Size(3, 3) || P.size() == Size(4, 3));
+        CV_Assert(R.empty() || (R.depth() == CV_32F || R.depth() == CV_64F));
+        CV_Assert(R.empty() || R.size() == Size(3, 3) || R.total() * R.channels() == 3);
+        CV_Assert(flags == omnidir::RECTIFY_PERSPECTIVE || flags == omnidir::RECTIFY_CYLINDRICAL || flags == omnidir::RECTIFY_LONGLATI
+            || flags == omnidir::RECTIFY_STEREOGRAPHIC);
+        CV_Assert(xi.total() == 1 && (xi.depth() == CV_32F || xi.depth() == CV_64F));
+
+        if (K.depth() == CV_32F)
+        {
+            Matx33f camMat = K.getMat();
+            m.f = Vec2f(camMat(0, 0), camMat(1, 1));
+            m.c = Vec2f(camMat(0, 2), camMat(1, 2));
+            m.s = (double)camMat(0,1);
+        }
+        else
+        {
+            Matx33d camMat = K.getMat();
+            m.f = Vec2d(camMat(0, 0), camMat(1, 1));
+            m.c = Vec2d(camMat(0, 2), camMat(1, 2));
+            m.s = camMat(0,1);
+        }
+
+        m.kp = Vec4d::all(0);
+        if (!D.empty())
+            m.kp = D.depth() == CV_32F ? (Vec4d)*D.getMat().ptr<Vec4f>(): *D.getMat().ptr<Vec4d>();
+        m.xi = xi.depth() == CV_32F ? (double)*xi.getMat().ptr<float>() : *xi.getMat().ptr<double>();
+
+        Matx33d RR;
+        getRotation(R, RR);
+
+        cv::Matx33d PP = cv::Matx33d::eye();
+        if (!P.empty())
+            P.getMat().colRange(0, 3).convertTo(PP, CV_64F);
+        else
+            K.getMat().convertTo(PP, CV_64F);
+
+        m.iKR = (PP*RR).inv(cv::DECOMP_SVD);
+        m.iK = PP.inv(cv::DECOMP_SVD);
+        m.iR = RR.inv(cv::DECOMP_SVD);
+        m.flags = flags;
+    }
+
+    // Largest lane count of the map kernels
+    const int MAP_LANES_PAD = 4;
+
+    // Fills the trigonometry tables of m for maps of the given size, or clears them when iK mixes rows and
+    // columns, so that the W x H sin and cos of the maps become W + H
+    void setTrigTables(RectifyParams& m, const Size& size)
+    {
+        m.cosTheta.clear(); m.sinTheta.clear();
+        m.cosH.clear(); m.sinH.clear();
+        if ((m.flags != omnidir::RECTIFY_CYLINDRICAL && m.flags != omnidir::RECTIFY_LONGLATI)
+            || std::abs(m.iK(0, 1)*size.height) > 1e-12 || std::abs(m.iK(1, 0)*size.width) > 1e-12)
+            return;
+
+        // padded for the last lane group of rectifyPixelsLanes
+        m.cosTheta.resize(size.width + MAP_LANES_PAD); m.sinTheta.resize(size.width + MAP_LANES_PAD);
+        for (int j = 0; j < (int)m.cosTheta.size(); ++j)
+        {
+            double theta = j*m.iK(0, 0) + m.iK(0, 2);
+            m.cosTheta[j] = std::cos(theta);
+            m.sinTheta[j] = std::sin(theta);
+        }
+        if (m.flags == omnidir::RECTIFY_LONGLATI)
+        {
+            m.cosH.resize(size.height); m.sinH.resize(size.height);
+            for (int i = 0; i < size.height; ++i)
+            {
+                double h = i*m.iK(1, 1) + m.iK(1, 2);
+                m.cosH[i] = std::cos(h);
+                m.sinH[i] = std::sin(h);
+            }
+        }
+    }
+
+    // Ray in the camera frame of the rectified pixel (x, y)
+    inline Vec3d rectifyRay(const RectifyParams& m, double x, double y)
+    {
+        if (m.flags == omnidir::RECTIFY_PERSPECTIVE)
+            return m.iKR * Vec3d(x, y, 1);
+
+        // for RECTIFY_LONGLATI, theta and h are longittude and latitude
+        double theta = x*m.iK(0, 0) + y*m.iK(0, 1) + m.iK(0, 2),
+               h     = x*m.iK(1, 0) + y*m.iK(1, 1) + m.iK(1, 2);
+
+        double _xt = 0.0, _yt = 0.0, _wt = 0.0;
+        if (m.flags == omnidir::RECTIFY_CYLINDRICAL)
+        {
+            //_xt = std::sin(theta);
+            //_yt = h;
+            //_wt = std::cos(theta);
+            _xt = std::cos(theta);
+            _yt = std::sin(theta);
+            _wt = h;
+        }
+        else if (m.flags == omnidir::RECTIFY_LONGLATI)
+        {
+            _xt = -std::cos(theta);
+            _yt = -std::sin(theta) * std::cos(h);
+            _wt = std::sin(theta) * std::sin(h);
+        }
+        else if (m.flags == omnidir::RECTIFY_STEREOGRAPHIC)
+        {
+            double a = theta*theta + h*h + 4;
+            double b = -2*theta*theta - 2*h*h;
+            double c2 = theta*theta + h*h -4;
+
+            _yt = (-b-std::sqrt(b*b - 4*a*c2))/(2*a);
+            _xt = theta*(1 - _yt) / 2;
+            _wt = h*(1 - _yt) / 2;
+        }
+        return m.iR * Vec3d(_xt, _yt, _wt);
+    }
+
+    // Distorted image pixel of a ray in the camera frame
+    inline Vec2d projectRay(const RectifyParams& m, const Vec3d& ray)
+    {
+        const double k1 = m.kp[0], k2 = m.kp[1], p1 = m.kp[2], p2 = m.kp[3];
+
+        // project back to unit sphere
+        double r = sqrt(ray[0]*ray[0] + ray[1]*ray[1] + ray[2]*ray[2]);
+        double Xs = ray[0] / r;
+        double Ys = ray[1] / r;
+        double Zs = ray[2] / r;
+        // project to image plane
+        double xu = Xs / (Zs + m.xi),
+               yu = Ys / (Zs + m.xi);
+        // add distortion
+        double r2 = xu*xu + yu*yu;
+        double r4 = r2*r2;
+        double xd = (1+k1*r2+k2*r4)*xu + 2*p1*xu*yu + p2*(r2+2*xu*xu);
+        double yd = (1+k1*r2+k2*r4)*yu + p1*(r2+2*yu*yu) + 2*p2*xu*yu;
+        // to image pixel
+        return Vec2d(m.f[0]*xd + m.s*yd + m.c[0], m.f[1]*yd + m.c[1]);
+    }
+
+    // Writes the distorted pixel (u, v) to element j of a map row, in the CV_16SC2 + CV_16UC1 fixed point format
+    // of cv::remap or as two CV_32FC1 maps
+    inline void storeMapPixel(double u, double v, int j, int m1type, void* map1Row, void* map2Row)
+    {
+        if( m1type == CV_16SC2 )
+        {
+            short* m1 = (short*)map1Row;
+            ushort* m2 = (ushort*)map2Row;
+            int iu = cv::saturate_cast<int>(u*cv::INTER_TAB_SIZE);
+            int iv = cv::saturate_cast<int>(v*cv::INTER_TAB_SIZE);
+            m1[j*2+0] = cv::saturate_cast<short>(iu >> cv::INTER_BITS);
+            m1[j*2+1] = cv::saturate_cast<short>(iv >> cv::INTER_BITS);
+            m2[j] = (ushort)((iv & (cv::INTER_TAB_SIZE-1))*cv::INTER_TAB_SIZE + (iu & (cv::INTER_TAB_SIZE-1)));
+        }
+        else if( m1type == CV_32FC1 )
+        {
+            ((float*)map1Row)[j] = (float)u;
+            ((float*)map2Row)[j] = (float)v;
+        }
+    }
+
+    // Bound of the part of the unit sphere that the model projects one to one, Zs > -min(xi, 1/xi)
+    inline double validRayZ(const RectifyParams& m)
+    {
+        return -std::min(m.xi, m.xi > 0 ? 1 / m.xi : 0.0);
+    }
+
+    // Whether element j of a map row is valid: Zs of its ray on the unit sphere is above validRayZ, and the
+    // distorted pixel stored in the maps is inside the image
+    inline bool mapPixelValid(double zs, double zmin, int j, int m1type, const void* map1Row, const void* map2Row,
+        const Size& imageSize)
+    {
+        if (!(zs > zmin))
+            return false;
+
+        double u, v;
+        if (m1type == CV_16SC2)
+        {
+            const short* m1 = (const short*)map1Row + j*2;
+            int a = ((const ushort*)map2Row)[j];
+            u = m1[0] + (a & (INTER_TAB_SIZE - 1)) * (1.0 / INTER_TAB_SIZE);
+            v = m1[1] + (a >> INTER_BITS) * (1.0 / INTER_TAB_SIZE);
+        }
+        else
+        {
+            u = ((const float*)map1Row)[j];
+            v = ((const float*)map2Row)[j];
+        }
+        return u >= 0 && u <= imageSize.width - 1 && v >= 0 && v <= imageSize.height - 1;
+    }
+
+#if CV_SIMD128
+    template<typename V> struct LaneCount { enum { value = V::nlanes }; };
+
+    inline void lanesLoad(const double* p, v_float32x4& v)
+    {
+        float buf[4] = { (float)p[0], (float)p[1], (float)p[2], (float)p[3] };
+        v = v_load(buf);
+    }
+    inline v_float32x4 lanesRound(const v_float32x4& v) { return v_cvt_f32(v_round(v)); }
+    inline void lanesStore(float* p, const v_float32x4& v) { v_store(p, v); }
+#if CV_SIMD128_64F
+    inline void lanesLoad(const double* p, v_float64x2& v) { v = v_load(p); }
+    inline v_float64x2 lanesRound(const v_float64x2& v) { return v_cvt_f64(v_round(v)); }
+    inline void lanesStore(float* p, const v_float64x2& v) { v_store_low(p, v_cvt_f32(v)); }
+#endif
+
+    // sin and cos of all lanes. The argument is reduced to [-pi/4, pi/4] around the nearest multiple k of pi/2,
+    // where the Taylor polynomials are accurate to double precision, and k mod 4 swaps them and sets their
+    // signs by arithmetic rather than branches.
+    template<typename V> inline void lanesSinCos(const V& x, V& s, V& c)
+    {
+        const V one = lanesAll<V>(1.0), two = lanesAll<V>(2.0), half = lanesAll<V>(0.5), quarter = lanesAll<V>(0.25);
+
+        V k = lanesRound(x*lanesAll<V>(2/CV_PI));
+        V r = (x - k*lanesAll<V>(1.57079632673412561417)) - k*lanesAll<V>(6.07710050650619224932e-11);
+        V q = k - lanesAll<V>(4.0)*lanesRound(k*quarter - lanesAll<V>(0.375));    // k mod 4
+        V upper = lanesRound(q*half - quarter);     // q >= 2
+        V swap = q - two*upper;                     // q is odd
+
+        V r2 = r*r;
+        V ps = r*(one + r2*(lanesAll<V>(-1/6.) + r2*(lanesAll<V>(1/120.) + r2*(lanesAll<V>(-1/5040.)
+            + r2*(lanesAll<V>(1/362880.) + r2*(lanesAll<V>(-1/39916800.) + r2*(lanesAll<V>(1/6227020800.)
+            + r2*lanesAll<V>(-1/1307674368000.))))))));
+        V pc = one + r2*(lanesAll<V>(-1/2.) + r2*(lanesAll<V>(1/24.) + r2*(lanesAll<V>(-1/720.)
+            + r2*(lanesAll<V>(1/40320.) + r2*(lanesAll<V>(-1/3628800.) + r2*(lanesAll<V>(1/479001600.)
+            + r2*(lanesAll<V>(-1/87178291200.) + r2*lanesAll<V>(1/20922789888000.))))))));
+
+        s = (one - two*upper)*(ps + swap*(pc - ps));
+        c = (one - two*(swap + upper - two*swap*upper))*(pc + swap*(ps - pc));
+    }
+
+    // RectifyParams, each broadcast to all lanes of V
+    template<typename V> struct RectifyLanes
+    {
+        V iKR[9], iK[6], iR[9];
+        V fx, fy, s, cx, cy, xi, k1, k2, p1, p2;
+        V index;    // 0, 1, ... in the lanes
+
+        explicit RectifyLanes(const RectifyParams& m)
+        {
+            for (int i = 0; i < 9; i++)
+            {
+                iKR[i] = lanesAll<V>(m.iKR.val[i]);
+                iR[i] = lanesAll<V>(m.iR.val[i]);
+            }
+            for (int i = 0; i < 6; i++)
+                iK[i] = lanesAll<V>(m.iK.val[i]);
+            fx = lanesAll<V>(m.f[0]); fy = lanesAll<V>(m.f[1]); s = lanesAll<V>(m.s);
+            cx = lanesAll<V>(m.c[0]); cy = lanesAll<V>(m.c[1]); xi = lanesAll<V>(m.xi);
+            k1 = lanesAll<V>(m.kp[0]); k2 = lanesAll<V>(m.kp[1]); p1 = lanesAll<V>(m.kp[2]); p2 = lanesAll<V>(m.kp[3]);
+
+            static const double lanes[MAP_LANES_PAD] = { 0, 1, 2, 3 };
+            lanesLoad(lanes, index);
+        }
+    };
+
+    // projectRay in lanes of V, the pixels being stored to u and v, and Zs of the rays on the unit sphere to zs
+    // when it is given
+    template<typename V> inline void projectRayLanes(const RectifyLanes<V>& l, const V& X, const V& Y, const V& Z,
+        float* u, float* v, float* zs = 0)
+    {
+        const V one = lanesAll<V>(1.0), two = lanesAll<V>(2.0);
+
+        // project back to unit sphere
+        V ir = one / lanesSqrt(X*X + Y*Y + Z*Z);
+        V Xs = X*ir, Ys = Y*ir, Zs = Z*ir;
+        if (zs)
+            lanesStore(zs, Zs);
+        // project to image plane
+        V iz = one / (Zs + l.xi);
+        V xu = Xs*iz, yu = Ys*iz;
+        // add distortion
+        V r2 = xu*xu + yu*yu;
+        V radial = one + l.k1*r2 + l.k2*r2*r2;
+        V xd = radial*xu + two*l.p1*xu*yu + l.p2*(r2 + two*xu*xu);
+        V yd = radial*yu + l.p1*(r2 + two*yu*yu) + two*l.p2*xu*yu;
+        // to image pixel
+        lanesStore(u, l.fx*xd + l.s*yd + l.cx);
+        lanesStore(v, l.fy*yd + l.cy);
+    }
+
+    // rectifyRay and projectRay of the columns [x0, x0 + n) of row y, in lanes of V. The map pixels are written
+    // to u and v, which have room for n rounded up to whole lane groups. A pixel only depends on its column,
+    // not on x0, so maps computed in tiles agree with maps computed in rows. Zs of the rays goes to zs when it is
+    // given, see projectRayLanes.
+    template<typename V> void rectifyPixelsLanes(const RectifyParams& m, const RectifyLanes<V>& l, int y, int x0, int n,
+        float* u, float* v, float* zs = 0)
+    {
+        const int nlanes = LaneCount<V>::value;
+        const V zero = lanesAll<V>(0.0), one = lanesAll<V>(1.0), two = lanesAll<V>(2.0), four = lanesAll<V>(4.0);
+        const V yy = lanesAll<V>(y);
+        const V hRow = lanesAll<V>(y*m.iK(1, 1) + m.iK(1, 2));
+        const V cosH = lanesAll<V>(m.cosH.empty() ? 0 : m.cosH[y]), sinH = lanesAll<V>(m.sinH.empty() ? 0 : m.sinH[y]);
+        const bool tables = !m.cosTheta.empty();
+
+        for (int j = 0; j < n; j += nlanes)
+        {
+            V x = lanesAll<V>(x0 + j) + l.index;
+            V X, Y, Z;
+            if (m.flags == omnidir::RECTIFY_PERSPECTIVE)
+            {
+                X = l.iKR[0]*x + l.iKR[1]*yy + l.iKR[2];
+                Y = l.iKR[3]*x + l.iKR[4]*yy + l.iKR[5];
+                Z = l.iKR[6]*x + l.iKR[7]*yy + l.iKR[8];
+            }
+            else
+            {
+                V theta = l.iK[0]*x + l.iK[1]*yy + l.iK[2];
+                V h = l.iK[3]*x + l.iK[4]*yy + l.iK[5];
+                V _xt, _yt, _wt;
+                if (m.flags == omnidir::RECTIFY_STEREOGRAPHIC)
+                {
+                    V a = theta*theta + h*h + four;
+                    V b = zero - two*theta*theta - two*h*h;
+                    V c2 = theta*theta + h*h - four;
+
+                    _yt = (zero - b - lanesSqrt(b*b - four*a*c2))/(two*a);
+                    _xt = theta*(one - _yt)/two;
+                    _wt = h*(one - _yt)/two;
+                }
+                else
+                {
+                    V ct, st, ch = cosH, sh = sinH;
+                    if (tables)
+                    {
+                        lanesLoad(&m.cosTheta[x0 + j], ct);
+                        lanesLoad(&m.sinTheta[x0 + j], st);
+                        h = hRow;
+                    }
+                    else
+                    {
+                        lanesSinCos(theta, st, ct);
+                        if (m.flags == omnidir::RECTIFY_LONGLATI)
+                            lanesSinCos(h, sh, ch);
+                    }
+
+                    if (m.flags == omnidir::RECTIFY_CYLINDRICAL)
+                    {
+                        _xt = ct;
+                        _yt = st;
+                        _wt = h;
+                    }
+                    else
+                    {
+                        _xt = zero - ct;
+                        _yt = zero - st*ch;
+                        _wt = st*sh;
+                    }
+                }
+                X = l.iR[0]*_xt + l.iR[1]*_yt + l.iR[2]*_wt;
+                Y = l.iR[3]*_xt + l.iR[4]*_yt + l.iR[5]*_wt;
+                Z = l.iR[6]*_xt + l.iR[7]*_yt + l.iR[8]*_wt;
+            }
+
+            projectRayLanes(l, X, Y, Z, u + j, v + j, zs ? zs + j : 0);
+        }
+    }
+
+    // storeMapPixel of n pixels starting at element j0 of the map rows, eight at a time for CV_16SC2
+    inline void storeMapPixels(const float* u, const float* v, int n, int j0, int m1type, void* map1Row, void* map2Row)
+    {
+        int j = 0;
+        if (m1type == CV_16SC2)
+        {
+            short* m1 = (short*)map1Row + 2*j0;
+            ushort* m2 = (ushort*)map2Row + j0;
+            const v_float32x4 scale = v_setall_f32((float)INTER_TAB_SIZE);
+            const v_int32x4 mask = v_setall_s32(INTER_TAB_SIZE - 1);
+            for (; j <= n - 8; j += 8)
+            {
+                v_int32x4 iu0 = v_round(v_load(u + j)*scale), iu1 = v_round(v_load(u + j + 4)*scale);
+                v_int32x4 iv0 = v_round(v_load(v + j)*scale), iv1 = v_round(v_load(v + j + 4)*scale);
+
+                v_int16x8 xy0, xy1;
+                v_zip(v_pack(iu0 >> INTER_BITS, iu1 >> INTER_BITS), v_pack(iv0 >> INTER_BITS, iv1 >> INTER_BITS), xy0, xy1);
+                v_store(m1 + 2*j, xy0);
+                v_store(m1 + 2*j + 8, xy1);
+
+                v_int32x4 a0 = ((iv0 & mask) << INTER_BITS) + (iu0 & mask);
+                v_int32x4 a1 = ((iv1 & mask) << INTER_BITS) + (iu1 & mask);
+                v_store(m2 + j, v_reinterpret_as_u16(v_pack(a0, a1)));
+            }
+        }
+        else if (m1type == CV_32FC1)
+        {
+            memcpy((float*)map1Row + j0, u, n*sizeof(float));
+            memcpy((float*)map2Row + j0, v, n*sizeof(float));
+            j = n;
+        }
+
+        for (; j < n; ++j)
+            storeMapPixel(u[j], v[j], j0 + j, m1type, map1Row, map2Row);
+    }
+
+    // The mask of n map pixels starting at element j0 of the map rows, from Zs of their rays and the pixels stored
+    inline void maskMapPixels(const float* zs, double zmin, int n, int j0, int m1type, const void* map1Row,
+        const void* map2Row, const Size& imageSize, uchar* maskRow)
+    {
+        for (int j = 0; j < n; ++j)
+            maskRow[j0 + j] = mapPixelValid(zs[j], zmin, j0 + j, m1type, map1Row, map2Row, imageSize) ? 255 : 0;
+    }
+
+    // rectifyMapRow in blocks of pixels computed in lanes. The fixed point maps are computed in float, whose error
+    // is far below their 1/INTER_TAB_SIZE resolution, and the float maps in double where it is supported.
+    inline void rectifyMapRowSIMD(const RectifyParams& m, int y, int x0, int x1, int m1type, void* map1Row, void* map2Row,
+        uchar* maskRow, const Size& imageSize)
+    {
+        const int BLOCK = 64;
+        float u[BLOCK + MAP_LANES_PAD], v[BLOCK + MAP_LANES_PAD], zs[BLOCK + MAP_LANES_PAD];
+        const double zmin = validRayZ(m);
+#if CV_SIMD128_64F
+        if (m1type == CV_32FC1)
+        {
+            RectifyLanes<v_float64x2> l(m);
+            for (int j = x0; j < x1; j += BLOCK)
+            {
+                int n = std::min(BLOCK, x1 - j);
+                rectifyPixelsLanes(m, l, y, j, n, u, v, maskRow ? zs : 0);
+                storeMapPixels(u, v, n, j - x0, m1type, map1Row, map2Row);
+                if (maskRow)
+                    maskMapPixels(zs, zmin, n, j - x0, m1type, map1Row, map2Row, imageSize, maskRow);
+            }
+            return;
+        }
+#endif
+        RectifyLanes<v_float32x4> l(m);
+        for (int j = x0; j < x1; j += BLOCK)
+        {
+            int n = std::min(BLOCK, x1 - j);
+            rectifyPixelsLanes(m, l, y, j, n, u, v, maskRow ? zs : 0);
+            storeMapPixels(u, v, n, j - x0, m1type, map1Row, map2Row);
+            if (maskRow)
+                maskMapPixels(zs, zmin, n, j - x0, m1type, map1Row, map2Row, imageSize, maskRow);
+        }
+    }
+#endif
+
+    // Fills the map pixels of the rectified columns [x0, x1) of row y, element 0 of map1Row and map2Row
+    // being column x0. When maskRow is given, its elements are set to 255 for the valid pixels, see
+    // mapPixelValid, and to 0 for the others.
+    inline void rectifyMapRow(const RectifyParams& m, int y, int x0, int x1, int m1type, void* map1Row, void* map2Row,
+        uchar* maskRow = 0, const Size& imageSize = Size())
+    {
+#if CV_SIMD128
+        if (hasSIMD128())
+        {
+            rectifyMapRowSIMD(m, y, x0, x1, m1type, map1Row, map2Row, maskRow, imageSize);
+            return;
+        }
+#endif
+
+        const double zmin = validRayZ(m);
+        const bool tables = !m.cosTheta.empty();
+        // the rays from the tables, as in rectifyRay
+        const double h = y*m.iK(1, 1) + m.iK(1, 2);
+        const double cosH = m.cosH.empty() ? 0 : m.cosH[y], sinH = m.sinH.empty() ? 0 : m.sinH[y];
+        for (int j = x0; j < x1; ++j)
+        {
+            Vec3d ray;
+            if (tables)
+                ray = m.iR * (m.flags == omnidir::RECTIFY_CYLINDRICAL ? Vec3d(m.cosTheta[j], m.sinTheta[j], h)
+                    : Vec3d(-m.cosTheta[j], -m.sinTheta[j] * cosH, m.sinTheta[j] * sinH));
+            else
+                ray = rectifyRay(m, j, y);
+            Vec2d uv = projectRay(m, ray);
+            storeMapPixel(uv[0], uv[1], j - x0, m1type, map1Row, map2Row);
+            if (maskRow)
+                maskRow[j - x0] = mapPixelValid(ray[2] / cv::norm(ray), zmin, j - x0, m1type, map1Row, map2Row,
+                    imageSize) ? 255 : 0;
+        }
+    }
+
+    // The runs of non zero pixels of mask, as (row, first column, column after the last)
+    void getMaskSpans(const Mat& mask, std::vector<Vec3i>& spans)
+    {
+        spans.clear();
+        for (int i = 0; i < mask.rows; ++i)
+        {
+            const uchar* row = mask.ptr<uchar>(i);
+            for (int j = 0; j < mask.cols; ++j)
+            {
+                if (!row[j])
+                    continue;
+                int start = j;
+                while (j < mask.cols && row[j])
+                    ++j;
+                spans.push_back(Vec3i(i, start, j));
+            }
+        }
+    }
+
+    // Fills the map pixels of the columns [x0, x1) of a row from the rays of its pixels before the rotation m.iR,
+    // given as CV_32FC3 from column 0, element 0 of map1Row and map2Row being column x0
+    inline void rayMapRow(const RectifyParams& m, const float* rays, int x0, int x1, int m1type,
+        void* map1Row, void* map2Row)
+    {
+#if CV_SIMD128
+        if (hasSIMD128())
+        {
+            const int BLOCK = 64;
+            float u[BLOCK + MAP_LANES_PAD], v[BLOCK + MAP_LANES_PAD];
+            RectifyLanes<v_float32x4> l(m);
+            for (int j0 = x0; j0 < x1; j0 += BLOCK)
+            {
+                int n = std::min(BLOCK, x1 - j0);
+                for (int j = 0; j < n; j += 4)
+                {
+                    // the last rays of the row are copied to a full lane group, so that a pixel does not
+                    // depend on x0
+                    const float* r = rays + 3*(j0 + j);
+                    float last[12] = { 0 };
+                    if (j + 4 > n)
+                    {
+                        memcpy(last, r, 3*(n - j)*sizeof(float));
+                        r = last;
+                    }
+
+                    v_float32x4 rx, ry, rz;
+                    v_load_deinterleave(r, rx, ry, rz);
+                    projectRayLanes(l, l.iR[0]*rx + l.iR[1]*ry + l.iR[2]*rz, l.iR[3]*rx + l.iR[4]*ry + l.iR[5]*rz,
+                        l.iR[6]*rx + l.iR[7]*ry + l.iR[8]*rz, u + j, v + j);
+                }
+                storeMapPixels(u, v, n, j0 - x0, m1type, map1Row, map2Row);
+            }
+            return;
+        }
+#endif
+
+        for (int j = x0; j < x1; ++j)
+        {
+            const float* b = rays + 3*j;
+            Vec2d uv = projectRay(m, m.iR * Vec3d(b[0], b[1], b[2]));
+            storeMapPixel(uv[0], uv[1], j - x0, m1type, map1Row, map2Row);
+        }
+    }
+
+    // initUndistortRectifyMap of a range of rows, element (0, 0) of the maps being the rectified pixel origin.
+    // The mask of the valid pixels is filled along when it is not empty.
+    class RectifyMapInvoker : public ParallelLoopBody
+    {
+    public:
+        RectifyMapInvoker(const RectifyParams& _m, Mat& _map1, Mat& _map2, const Point& _origin = Point())
+            : m(_m), map1(_map1), map2(_map2), origin(_origin)
+        {
+        }
+
+        RectifyMapInvoker(const RectifyParams& _m, Mat& _map1, Mat& _map2, const Mat& _mask, const Size& _imageSize)
+            : m(_m), map1(_map1), map2(_map2), mask(_mask), imageSize(_imageSize)
+        {
+        }
+
+        virtual void operator()(const Range& range) const
+        {
+            const int m1type = map1.type();
+            for (int i = range.start; i < range.end; ++i)
+                rectifyMapRow(m, origin.y + i, origin.x, origin.x + map1.cols, m1type, map1.ptr(i), map2.ptr(i),
+                    mask.empty() ? 0 : mask.ptr<uchar>(i), imageSize);
+        }
+
+    private:
+        const RectifyParams& m;
+        Mat& map1;
+        Mat& map2;
+        Point origin;
+        Mat mask;
+        Size imageSize;
+
+        RectifyMapInvoker& operator=(const RectifyMapInvoker&);
+    };
+
+    // Tiles of rectifyImage, small enough that their maps stay in the L1 cache
+    const int FUSED_TILE_WIDTH = 64, FUSED_TILE_HEIGHT = 16;
+
+    // rectifyImage of a range of tiles, numbered row by row. The maps of a tile are computed into buffers on
+    // the stack and consumed at once by cv::remap of that tile. Pixel (0, 0) of dst is the rectified pixel origin.
+    class FusedRemapInvoker : public ParallelLoopBody
+    {
+    public:
+        FusedRemapInvoker(const RectifyParams& _m, const Mat& _src, Mat& _dst, int _interpolation, int _borderMode,
+            const Point& _origin = Point()) : m(_m), src(_src), dst(_dst), interpolation(_interpolation),
+            borderMode(_borderMode), origin(_origin)
+        {
+        }
+
+        virtual void operator()(const Range& range) const
+        {
+            short xy[FUSED_TILE_WIDTH*FUSED_TILE_HEIGHT*2];
+            ushort a[FUSED_TILE_WIDTH*FUSED_TILE_HEIGHT];
+
+            const int tilesX = (dst.cols + FUSED_TILE_WIDTH - 1) / FUSED_TILE_WIDTH;
+            for (int t = range.start; t < range.end; ++t)
+            {
+                Rect roi((t % tilesX) * FUSED_TILE_WIDTH, (t / tilesX) * FUSED_TILE_HEIGHT, FUSED_TILE_WIDTH, FUSED_TILE_HEIGHT);
+                roi &= Rect(0, 0, dst.cols, dst.rows);
+
+                Mat map1(roi.size(), CV_16SC2, xy), map2(roi.size(), CV_16UC1, a);
+                for (int i = 0; i < roi.height; ++i)
+                    rectifyMapRow(m, origin.y + roi.y + i, origin.x + roi.x, origin.x + roi.x + roi.width, CV_16SC2,
+                        map1.ptr(i), map2.ptr(i));
+
+                Mat dstTile = dst(roi);
+                cv::remap(src, dstTile, map1, map2, interpolation, borderMode);
+            }
+        }
+
+    private:
+        const RectifyParams& m;
+        const Mat& src;
+        Mat& dst;
+        int interpolation;
+        int borderMode;
+        Point origin;
+
+        FusedRemapInvoker& operator=(const FusedRemapInvoker&);
+    };
+
+    // VirtualCamera::setRotation of a range of rows
+    class RayMapInvoker : public ParallelLoopBody
+    {
+    public:
+        RayMapInvoker(const RectifyParams& _m, const Mat& _rays, Mat& _map1, Mat& _map2) : m(_m),
+            rays(_rays), map1(_map1), map2(_map2)
+        {
+        }
+
+        virtual void operator()(const Range& range) const
+        {
+            for (int i = range.start; i < range.end; ++i)
+                rayMapRow(m, rays.ptr<float>(i), 0, map1.cols, CV_16SC2, map1.ptr(i), map2.ptr(i));
+        }
+
+    private:
+        const RectifyParams& m;
+        const Mat& rays;
+        Mat& map1;
+        Mat& map2;
+
+        RayMapInvoker& operator=(const RayMapInvoker&);
+    };
+
+    // VirtualCamera::render of a range of tiles, numbered row by row as in FusedRemapInvoker. The maps of a tile
+    // are updated and consumed by cv::remap of that tile while they are still in the cache.
+    class RayRemapInvoker : public ParallelLoopBody
+    {
+    public:
+        RayRemapInvoker(const RectifyParams& _m, const Mat& _rays, Mat& _map1, Mat& _map2, const Mat& _src,
+            Mat& _dst, int _interpolation, int _borderMode) : m(_m), rays(_rays), map1(_map1), map2(_map2),
+            src(_src), dst(_dst), interpolation(_interpolation), borderMode(_borderMode)
+        {
+        }
+
+        virtual void operator()(const Range& range) const
+        {
+            const int tilesX = (dst.cols + FUSED_TILE_WIDTH - 1) / FUSED_TILE_WIDTH;
+            for (int t = range.start; t < range.end; ++t)
+            {
+                Rect roi((t % tilesX) * FUSED_TILE_WIDTH, (t / tilesX) * FUSED_TILE_HEIGHT, FUSED_TILE_WIDTH, FUSED_TILE_HEIGHT);
+                roi &= Rect(0, 0, dst.cols, dst.rows);
+
+                for (int i = roi.y; i < roi.y + roi.height; ++i)
+                    rayMapRow(m, rays.ptr<float>(i), roi.x, roi.x + roi.width, CV_16SC2,
+                        map1.ptr<short>(i) + 2*roi.x, map2.ptr<ushort>(i) + roi.x);
+
+                Mat dstTile = dst(roi);
+                cv::remap(src, dstTile, map1(roi), map2(roi), interpolation, borderMode);
+            }
+        }
+
+    private:
+        const RectifyParams& m;
+        const Mat& rays;
+        Mat& map1;
+        Mat& map2;
+        const Mat& src;
+        Mat& dst;
+        int interpolation;
+        int borderMode;
+
+        RayRemapInvoker& operator=(const RayRemapInvoker&);
+    };
+
+    // Points of a cell, in fractions of the cell, where the interpolation error is sampled: a 3x3 lattice inside
+    // the cell and the edge midpoints
+    const double COARSE_ERROR_SAMPLES[13][2] = {
+        {0.25, 0.25}, {0.5, 0.25}, {0.75, 0.25},
+        {0.25, 0.5},  {0.5, 0.5},  {0.75, 0.5},
+        {0.25, 0.75}, {0.5, 0.75}, {0.75, 0.75},
+        {0.5, 0}, {0, 0.5}, {1, 0.5}, {0.5, 1}
+    };
+
+    // Part of maxError the sampled error of an interpolated cell may reach, the rest being left for the error
+    // between the samples
+    const double COARSE_ERROR_MARGIN = 0.8;
+
+    // initUndistortRectifyMapCoarse of a range of cell rows. The map pixels of a cell are interpolated
+    // bilinearly between the exact map at its corners, the nodes, unless the interpolation is off by more than
+    // COARSE_ERROR_MARGIN*maxError at one of COARSE_ERROR_SAMPLES, in which case they are computed exactly.
+    class CoarseRectifyMapInvoker : public ParallelLoopBody
+    {
+    public:
+        CoarseRectifyMapInvoker(const RectifyParams& _m, const Mat& _nodes, int _step, double _maxError, Mat& _map1,
+            Mat& _map2, Mat& _cellError) : m(_m), nodes(_nodes), step(_step), maxError(_maxError), map1(_map1),
+            map2(_map2), cellError(_cellError)
+        {
+        }
+
+        virtual void operator()(const Range& range) const
+        {
+            const int m1type = map1.type();
+            const double istep = 1.0 / step;
+            for (int cy = range.start; cy < range.end; ++cy)
+            {
+                const Vec2d* n0 = nodes.ptr<Vec2d>(cy);
+                const Vec2d* n1 = nodes.ptr<Vec2d>(cy + 1);
+                int y0 = cy*step, y1 = std::min(y0 + step, map1.rows);
+                for (int cx = 0; cx < nodes.cols - 1; ++cx)
+                {
+                    int x0 = cx*step, x1 = std::min(x0 + step, map1.cols);
+                    const Vec2d g00 = n0[cx], g10 = n0[cx + 1], g01 = n1[cx], g11 = n1[cx + 1];
+
+                    double error = 0;
+                    for (int k = 0; k < 13; ++k)
+                    {
+                        double fx = COARSE_ERROR_SAMPLES[k][0], fy = COARSE_ERROR_SAMPLES[k][1];
+                        Vec2d exact = projectRay(m, rectifyRay(m, x0 + fx*step, y0 + fy*step));
+                        Vec2d interpolated = (1 - fy)*((1 - fx)*g00 + fx*g10) + fy*((1 - fx)*g01 + fx*g11);
+                        double e = cv::norm(exact - interpolated);
+                        if (!(e <= error))    // keeps NaN
+                            error = e;
+                    }
+                    bool exact = !(error <= COARSE_ERROR_MARGIN*maxError);
+                    if (!cellError.empty())
+                        cellError.at<float>(cy, cx) = exact ? 0.f : (float)error;
+
+                    for (int y = y0; y < y1; ++y)
+                    {
+                        uchar* m1 = map1.ptr(y);
+                        uchar* m2 = map2.ptr(y);
+                        if (exact)
+                        {
+                            rectifyMapRow(m, y, x0, x1, m1type, m1 + x0*map1.elemSize(), m2 + x0*map2.elemSize());
+                            continue;
+                        }
+
+                        double fy = (y - y0)*istep;
+                        Vec2d left = (1 - fy)*g00 + fy*g01, right = (1 - fy)*g10 + fy*g11;
+                        for (int x = x0; x < x1; ++x)
+                        {
+                            double fx = (x - x0)*istep;
+                            Vec2d uv = (1 - fx)*left + fx*right;
+                            storeMapPixel(uv[0], uv[1], x, m1type, m1, m2);
+                        }
+                    }
+                }
+            }
+        }
+
+    private:
+        const RectifyParams& m;
+        const Mat& nodes;
+        int step;
+        double maxError;
+        Mat& map1;
+        Mat& map2;
+        Mat& cellError;
+
+        CoarseRectifyMapInvoker& operator=(const CoarseRectifyMapInvoker&);
+    };
+
+    // The bounding boxes of the integer parts of the source coordinates of a range of tiles of the maps, for
+    // TiledRemapper and initUndistortRectifyMapROI
+    class TileFootprintInvoker : public ParallelLoopBody
+    {
+    public:
+        TileFootprintInvoker(const Mat& _map1, const Mat& _map2, const std::vector<Rect>& _tiles,
+            std::vector<Rect>& _sources) : map1(_map1), map2(_map2), tiles(_tiles), sources(_sources)
+        {
+        }
+
+        virtual void operator()(const Range& range) const
+        {
+            for (int t = range.start; t < range.end; ++t)
+            {
+                const Rect& tile = tiles[t];
+                int x0 = INT_MAX, y0 = INT_MAX, x1 = INT_MIN, y1 = INT_MIN;
+                for (int i = tile.y; i < tile.y + tile.height; ++i)
+                {
+                    for (int j = tile.x; j < tile.x + tile.width; ++j)
+                    {
+                        int x, y;
+                        if (map1.type() == CV_16SC2)
+                        {
+                            const short* xy = map1.ptr<short>(i) + 2*j;
+                            x = xy[0];
+                            y = xy[1];
+                        }
+                        else
+                        {
+                            float fx = map1.ptr<float>(i)[j], fy = map2.ptr<float>(i)[j];
+                            if (cvIsNaN(fx) || cvIsNaN(fy))
+                                continue;
+                            // as converted by cv::remap
+                            x = cvFloor(std::min(std::max(fx, (float)SHRT_MIN), (float)SHRT_MAX));
+                            y = cvFloor(std::min(std::max(fy, (float)SHRT_MIN), (float)SHRT_MAX));
+                        }
+                        x0 = std::min(x0, x); x1 = std::max(x1, x);
+                        y0 = std::min(y0, y); y1 = std::max(y1, y);
+                    }
+                }
+                sources[t] = x0 <= x1 ? Rect(x0, y0, x1 - x0 + 1, y1 - y0 + 1) : Rect();
+            }
+        }
+
+    private:
+        const Mat& map1;
+        const Mat& map2;
+        const std::vector<Rect>& tiles;
+        std::vector<Rect>& sources;
+
+        TileFootprintInvoker& operator=(const TileFootprintInvoker&);
+    };
+}}
+
+/////////////////////////////////////////////////////////////////////////////
+//////// projectPoints
+void cv::omnidir::projectPoints(InputArray objectPoints, OutputArray imagePoints,
+                InputArray rvec, InputArray tvec, InputArray K, double xi, InputArray D, OutputArray jacobian)
+{
+    omnidir::internal::projectPoints(objectPoints, imagePoints, rvec, tvec, K, xi, D, jacobian, 0);
+}
+
+void cv::omnidir::internal::projectPoints(InputArray objectPoints, OutputArray imagePoints,
+                InputArray rvec, InputArray tvec, InputArray K, double xi, InputArray D, OutputArray jacobian, int flags)
+{
+
+    CV_Assert(objectPoints.type() == CV_64FC3 || objectPoints.type() == CV_32FC3);
+    CV_Assert((rvec.depth() == CV_64F || rvec.depth() == CV_32F) && rvec.total() == 3);
+    CV_Assert((tvec.depth() == CV_64F || tvec.depth() == CV_32F) && tvec.total() == 3);
+
+    imagePoints.create(objectPoints.size(), CV_MAKETYPE(objectPoints.depth(), 2));
+
+    int n = (int)objectPoints.total();
+
+    Vec3d om = rvec.depth() == CV_32F ? (Vec3d)*rvec.getMat().ptr<Vec3f>() : *rvec.getMat().ptr<Vec3d>();
+
+    ProjectionParams p;
+    getProjectionIntrinsics(K, xi, D, p);
+    p.T = tvec.depth() == CV_32F ? (Vec3d)*tvec.getMat().ptr<Vec3f>() : *tvec.getMat().ptr<Vec3d>();
+
+    const Vec3d* Xw_alld = objectPoints.getMat().ptr<Vec3d>();
+    const Vec3f* Xw_allf = objectPoints.getMat().ptr<Vec3f>();
+    Vec2d* xpd = imagePoints.getMat().ptr<Vec2d>();
+    Vec2f* xpf = imagePoints.getMat().ptr<Vec2f>();
+
+    if (jacobian.needed())
+    {
+        Rodrigues(om, p.R, p.dRdom);
+
+        int nvars = 2+2+1+4+3+3+1; // f,c,s,kp,om,T,xi
+        jacobian.create(2*int(n), nvars, CV_64F);
+        JacobianRow *Jn = jacobian.getMat().ptr<JacobianRow>(0);
+
+        // only the columns of parameters that are not fixed by flags are computed
+        int live = flags2jacobian(flags);
+        if (flags & omnidir::CALIB_MIXED_PRECISION)
+        {
+            if (objectPoints.depth() == CV_32F)
+                projectPointsJacobianF32(p, Xw_allf, xpf, Jn, n, live);
+            else
+                projectPointsJacobianF32(p, Xw_alld, xpd, Jn, n, live);
+        }
+        else if (objectPoints.depth() == CV_32F)
+            projectPointsJacobian(p, Xw_allf, xpf, Jn, n, live);
+        else
+            projectPointsJacobian(p, Xw_alld, xpd, Jn, n, live);
+        return;
+    }
+
+    Rodrigues(om, p.R);
+
+    if (objectPoints.depth() == CV_32F)
+        projectPointsNoJacobian(p, Xw_allf, xpf, n);
+    else
+        projectPointsNoJacobian(p, Xw_alld, xpd, n);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//////// projectPointsBatch
+void cv::omnidir::projectPointsBatch(InputArrayOfArrays objectPoints, OutputArray imagePoints,
+                InputArrayOfArrays rvecs, InputArrayOfArrays tvecs, InputArray K, double xi, InputArray D)
+{
+    std::vector<Vec3d> oms, Ts;
+    getVec3dArray(rvecs, oms);
+    getVec3dArray(tvecs, Ts);
+    CV_Assert(!oms.empty() && oms.size() == Ts.size());
+    int nViews = (int)oms.size();
+
+    ProjectionParams p;
+    getProjectionIntrinsics(K, xi, D, p);
+
+    // either one set of points shared by all poses or one set per pose
+    bool shared = objectPoints.kind() != _InputArray::STD_VECTOR_MAT && objectPoints.kind() != _InputArray::STD_VECTOR_VECTOR;
+    CV_Assert(shared || (int)objectPoints.total() == nViews);
+    std::vector<Mat> objs(shared ? 1 : nViews);
+    for (int i = 0; i < (int)objs.size(); ++i)
+    {
+        Mat X = shared ? objectPoints.getMat() : objectPoints.getMat(i);
+        CV_Assert(X.type() == CV_64FC3 || X.type() == CV_32FC3);
+        CV_Assert(i == 0 || X.depth() == objs[0].depth());
+        objs[i] = X.isContinuous() ? X : X.clone();
+    }
+
+    std::vector<int> offsets(nViews + 1, 0);
+    for (int v = 0; v < nViews; ++v)
+        offsets[v + 1] = offsets[v] + (int)objs[shared ? 0 : v].total();
+
+    imagePoints.create(1, offsets[nViews], CV_MAKETYPE(objs[0].depth(), 2));
+    Mat dst = imagePoints.getMat();
+    CV_Assert(dst.isContinuous());
+
+    parallel_for_(Range(0, nViews), ProjectPointsBatchInvoker(p, oms, Ts, objs, offsets, dst));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//////// undistortPoints
+void cv::omnidir::undistortPoints( InputArray distorted, OutputArray undistorted,
+    InputArray K, InputArray D, InputArray xi, InputArray R)
+{
+    omnidir::undistortPoints(distorted, undistorted, K, D, xi, R, TermCriteria(3, 20, 1e-12));
+}
+
+void cv::omnidir::undistortPoints( InputArray distorted, OutputArray undistorted,
+    InputArray K, InputArray D, InputArray xi, InputArray R, TermCriteria criteria, OutputArray iterations)
+{
+    CV_Assert(distorted.type() == CV_64FC2 || distorted.type() == CV_32FC2);
+
+    UndistortParams u;
+    getUndistortParams(K, D, xi, R, criteria, u);
+
+    undistorted.create(distorted.size(), distorted.type());
+
+    int* iters = 0;
+    if (iterations.needed())
+    {
+        iterations.create(distorted.size(), CV_32S);
+        iters = iterations.getMat().ptr<int>();
+    }
+
+    Mat src = distorted.getMat(), dst = undistorted.getMat();
+    UndistortPointsInvoker invoker(u, src, dst, iters);
+
+    // large batches are split over threads
+    int n = (int)distorted.total();
+    if (n >= 16384)
+        parallel_for_(Range(0, n), invoker, n / 4096.0);
+    else
+        invoker(Range(0, n));
+}
+
+void cv::omnidir::undistortPoints( InputArray distorted, OutputArray undistorted,
+    InputArray K, InputArray D, InputArray xi, InputArray R, InputArray Dinv)
+{
+    CV_Assert(distorted.type() == CV_64FC2 || distorted.type() == CV_32FC2);
+
+    UndistortParams u;
+    getUndistortParams(K, D, xi, R, TermCriteria(3, 20, 1e-12), u);
+    setInverseDistortion(Dinv, u);
+
+    undistorted.create(distorted.size(), distorted.type());
+
+    Mat src = distorted.getMat(), dst = undistorted.getMat();
+    UndistortPointsInvoker invoker(u, src, dst, 0);
+
+    int n = (int)distorted.total();
+    if (n >= 16384)
+        parallel_for_(Range(0, n), invoker, n / 4096.0);
+    else
+        invoker(Range(0, n));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//////// unprojectToSphere
+void cv::omnidir::unprojectToSphere(InputArray distorted, OutputArray sphere, InputArray K, InputArray D, InputArray xi,
+    InputArray R, InputArray Dinv)
+{
+    CV_Assert(distorted.type() == CV_64FC2 || distorted.type() == CV_32FC2);
+
+    UndistortParams u;
+    getUndistortParams(K, D, xi, R, TermCriteria(3, 20, 1e-12), u);
+    if (!Dinv.empty())
+        setInverseDistortion(Dinv, u);
+
+    sphere.create(distorted.size(), CV_MAKETYPE(distorted.depth(), 3));
+
+    Mat src = distorted.getMat(), dst = sphere.getMat();
+    UndistortPointsInvoker invoker(u, src, dst, 0);
+
+    int n = (int)distorted.total();
+    if (n >= 16384)
+        parallel_for_(Range(0, n), invoker, n / 4096.0);
+    else
+        invoker(Range(0, n));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//////// fitInverseDistortion
+double cv::omnidir::fitInverseDistortion(InputArray K, InputArray D, InputArray xi, const Size& imageSize, OutputArray Dinv)
+{
+    CV_Assert(imageSize.width > 0 && imageSize.height > 0);
+
+    UndistortParams u;
+    getUndistortParams(K, D, xi, noArray(), TermCriteria(3, 100, 1e-15), u);
+    const double k1 = u.kp[0], k2 = u.kp[1], p1 = u.kp[2], p2 = u.kp[3];
+
+    // exact inverse on a grid over the image, keeping the points that lift to the sphere
+    const int gridW = 64, gridH = 48;
+    std::vector<Vec2d> pd, pu;
+    pd.reserve((gridW + 1)*(gridH + 1));
+    pu.reserve((gridW + 1)*(gridH + 1));
+    for (int y = 0; y <= gridH; ++y)
+    {
+        for (int x = 0; x <= gridW; ++x)
+        {
+            Vec2d pi((double)x*(imageSize.width - 1)/gridW, (double)y*(imageSize.height - 1)/gridH);
+            Vec2d pp((pi[0]*u.f[1]-u.c[0]*u.f[1]-u.s*(pi[1]-u.c[1]))/(u.f[0]*u.f[1]), (pi[1]-u.c[1])/u.f[1]);
+            Vec2d p = pp;
+            undistortNewton(pp, u.kp, u.maxCount, u.eps, p);
+            Vec3d Xs = liftToSphere(p, u.xi);
+            if (cvIsNaN(Xs[2]) || cvIsInf(Xs[2]))
+                continue;
+            pd.push_back(pp);
+            pu.push_back(p);
+        }
+    }
+    CV_Assert(pd.size() >= 6);
+
+    // linear least squares of pu - pd in the terms of inverseDistortion
+    Matx66d A;
+    Vec6d b;
+    for (size_t i = 0; i < pd.size(); ++i)
+    {
+        double x = pd[i][0], y = pd[i][1];
+        double r2 = x*x + y*y, r4 = r2*r2, r6 = r4*r2, r8 = r4*r4;
+        double Jx[6] = {x*r2, x*r4, x*r6, x*r8, 2*x*y, r2 + 2*x*x};
+        double Jy[6] = {y*r2, y*r4, y*r6, y*r8, r2 + 2*y*y, 2*x*y};
+        double ex = pu[i][0] - x, ey = pu[i][1] - y;
+        for (int r = 0; r < 6; ++r)
+        {
+            b(r) += Jx[r]*ex + Jy[r]*ey;
+            for (int c = 0; c < 6; ++c)
+                A(r, c) += Jx[r]*Jx[c] + Jy[r]*Jy[c];
+        }
+    }
+    Vec6d kinv = A.solve(b, DECOMP_SVD);
+
+    // largest reprojection error in pixels of the closed form and its Newton steps
+    double maxError = 0;
+    for (size_t i = 0; i < pd.size(); ++i)
+    {
+        Vec2d p = inverseDistortion(pd[i], kinv);
+        undistortNewton(pd[i], u.kp, INVERSE_NEWTON_STEPS, 0, p);
+
+        double xu = p[0], yu = p[1], r2 = xu*xu + yu*yu;
+        double radial = 1 + k1*r2 + k2*r2*r2;
+        double ex = xu*radial + 2*p1*xu*yu + p2*(r2 + 2*xu*xu) - pd[i][0];
+        double ey = yu*radial + p1*(r2 + 2*yu*yu) + 2*p2*xu*yu - pd[i][1];
+        maxError = std::max(maxError, cv::norm(Vec2d(u.f[0]*ex + u.s*ey, u.f[1]*ey)));
+    }
+
+    Mat(kinv).reshape(1, 1).copyTo(Dinv);
+    return maxError;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//////// UndistortPointsLUT
+cv::omnidir::UndistortPointsLUT::UndistortPointsLUT() : _xi(0), _interpolation(INTER_CUBIC), _maxError(0)
+{
+}
+
+cv::omnidir::UndistortPointsLUT::UndistortPointsLUT(InputArray K, InputArray D, InputArray xi, const Size& imageSize,
+    const Size& gridSize, int interpolation)
+{
+    create(K, D, xi, imageSize, gridSize, interpolation);
+}
+
+void cv::omnidir::UndistortPointsLUT::create(InputArray K, InputArray D, InputArray xi, const Size& imageSize,
+    const Size& gridSize, int interpolation)
+{
+    CV_Assert(imageSize.width > 1 && imageSize.height > 1 && gridSize.width > 0 && gridSize.height > 0);
+    CV_Assert(interpolation == INTER_LINEAR || interpolation == INTER_CUBIC);
+
+    UndistortParams u;
+    getUndistortParams(K, D, xi, noArray(), TermCriteria(3, 20, 1e-12), u);
+
+    _gridSize = gridSize;
+    _step = Vec2d((imageSize.width - 1.0) / gridSize.width, (imageSize.height - 1.0) / gridSize.height);
+    _K = Matx33d(u.f[0], u.s, u.c[0], 0, u.f[1], u.c[1], 0, 0, 1);
+    _D = u.kp;
+    _xi = u.xi;
+    _interpolation = interpolation;
+
+    int iter;
+    _grid.create(gridSize.height + 1, gridSize.width + 1, CV_64FC3);
+    for (int y = 0; y <= gridSize.height; ++y)
+    {
+        Vec3d* row = _grid.ptr<Vec3d>(y);
+        for (int x = 0; x <= gridSize.width; ++x)
+            row[x] = liftPixel(u, Vec2d(x*_step[0], y*_step[1]), iter);
+    }
+
+    // the error is measured on a 4x4 sub-grid of every cell. Points next to nodes the model cannot lift are
+    // lifted exactly, and a point the model cannot lift between valid nodes makes the error NaN.
+    const int sub = 4;
+    _maxError = 0;
+    for (int y = 0; y <= sub*gridSize.height; ++y)
+    {
+        for (int x = 0; x <= sub*gridSize.width; ++x)
+        {
+            if (x % sub == 0 && y % sub == 0)
+                continue;
+            Vec2d pi(x*_step[0]/sub, y*_step[1]/sub);
+            Vec3d Xs;
+            if (!interpolate(pi, Xs))
+                continue;
+            Vec3d exact = liftPixel(u, pi, iter);
+            double error = 2*std::asin(std::min(0.5*norm(exact - Xs), 1.0));
+            if (cvIsNaN(error) || error > _maxError)
+                _maxError = error;
+        }
+    }
+}
+
+cv::Vec3d cv::omnidir::UndistortPointsLUT::node(int x, int y) const
+{
+    // nodes outside the grid are extrapolated linearly, so that bicubic interpolation keeps its order at the border
+    if (x < 0)
+        return node(0, y)*2 - node(1, y);
+    if (x > _gridSize.width)
+        return node(_gridSize.width, y)*2 - node(_gridSize.width - 1, y);
+    if (y < 0)
+        return node(x, 0)*2 - node(x, 1);
+    if (y > _gridSize.height)
+        return node(x, _gridSize.height)*2 - node(x, _gridSize.height - 1);
+    return _grid.at<Vec3d>(y, x);
+}
+
+bool cv::omnidir::UndistortPointsLUT::interpolate(const Vec2d& pi, Vec3d& Xs) const
+{
+    double gx = pi[0] / _step[0], gy = pi[1] / _step[1];
+    int x0 = std::min(std::max(cvFloor(gx), 0), _gridSize.width - 1);
+    int y0 = std::min(std::max(cvFloor(gy), 0), _gridSize.height - 1);
+    double tx = gx - x0, ty = gy - y0;
+
+    Xs = Vec3d();
+    if (_interpolation == INTER_LINEAR)
+    {
+        const Vec3d* r0 = _grid.ptr<Vec3d>(y0);
+        const Vec3d* r1 = _grid.ptr<Vec3d>(y0 + 1);
+        Xs = (r0[x0]*(1 - tx) + r0[x0 + 1]*tx)*(1 - ty) + (r1[x0]*(1 - tx) + r1[x0 + 1]*tx)*ty;
+    }
+    else
+    {
+        // Catmull-Rom weights
+        double wx[4], wy[4];
+        wx[0] = ((-0.5*tx + 1.0)*tx - 0.5)*tx; wx[1] = (1.5*tx - 2.5)*tx*tx + 1.0;
+        wx[2] = ((-1.5*tx + 2.0)*tx + 0.5)*tx; wx[3] = (0.5*tx - 0.5)*tx*tx;
+        wy[0] = ((-0.5*ty + 1.0)*ty - 0.5)*ty; wy[1] = (1.5*ty - 2.5)*ty*ty + 1.0;
+        wy[2] = ((-1.5*ty + 2.0)*ty + 0.5)*ty; wy[3] = (0.5*ty - 0.5)*ty*ty;
+
+        bool inner = x0 > 0 && y0 > 0 && x0 + 2 <= _gridSize.width && y0 + 2 <= _gridSize.height;
+        for (int j = 0; j < 4; ++j)
+        {
+            Vec3d rowSum;
+            if (inner)
+            {
+                const Vec3d* r = _grid.ptr<Vec3d>(y0 - 1 + j) + x0 - 1;
+                rowSum = r[0]*wx[0] + r[1]*wx[1] + r[2]*wx[2] + r[3]*wx[3];
+            }
+            else
+            {
+                for (int i = 0; i < 4; ++i)
+                    rowSum += node(x0 - 1 + i, y0 - 1 + j)*wx[i];
+            }
+            Xs += rowSum*wy[j];
+        }
+    }
+
+    // the nodes where the model is not defined are NaN, and so is any sum they are part of
+    if (cvIsNaN(Xs[0]) || cvIsNaN(Xs[1]) || cvIsNaN(Xs[2]))
+        return false;
+    Xs /= norm(Xs);
+    return true;
+}
+
+void cv::omnidir::UndistortPointsLUT::undistortPoints(InputArray distorted, OutputArray undistorted, InputArray R) const
+{
+    CV_Assert(!empty());
+    CV_Assert(distorted.type() == CV_64FC2 || distorted.type() == CV_32FC2);
+
+    Matx33d RR;
+    getRotation(R, RR);
+
+    UndistortParams u;
+    getUndistortParams(_K, _D, Matx<double, 1, 1>(_xi), noArray(), TermCriteria(3, 20, 1e-12), u);
+
+    undistorted.create(distorted.size(), distorted.type());
+
+    const cv::Vec2d *srcd = distorted.getMat().ptr<cv::Vec2d>();
+    const cv::Vec2f *srcf = distorted.getMat().ptr<cv::Vec2f>();
+
+    cv::Vec2d *dstd = undistorted.getMat().ptr<cv::Vec2d>();
+    cv::Vec2f *dstf = undistorted.getMat().ptr<cv::Vec2f>();
+
+    int n = (int)distorted.total();
+    for (int i = 0; i < n; i++)
+    {
+        Vec2d pi = distorted.depth() == CV_32F ? (Vec2d)srcf[i]:(Vec2d)srcd[i];    // image point
+
+        Vec3d Xs;
+        int iter;
+        if (!interpolate(pi, Xs))
+            Xs = liftPixel(u, pi, iter);
+        Vec3d Xw = RR * Xs;
+        Xs = Xw / cv::norm(Xw);
+
+        Vec2d ppu(Xs[0]/(Xs[2]+_xi), Xs[1]/(Xs[2]+_xi));
+        if (distorted.depth() == CV_32F)
+            dstf[i] = ppu;
+        else
+            dstd[i] = ppu;
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//////// cv::omnidir::initUndistortRectifyMap
+void cv::omnidir::initUndistortRectifyMap(InputArray K, InputArray D, InputArray xi, InputArray R, InputArray P,
+    const cv::Size& size, int m1type, OutputArray map1, OutputArray map2, int flags)
+{
+    CV_Assert( m1type == CV_16SC2 || m1type == CV_32F || m1type <=0 );
+
+    RectifyParams m;
+    getRectifyParams(K, D, xi, R, P, flags, m);
+    setTrigTables(m, size);
+
+    map1.create( size, m1type <= 0 ? CV_16SC2 : m1type );
+    map2.create( size, map1.type() == CV_16SC2 ? CV_16UC1 : CV_32F );
+
+    // the rows are independent, so they are split over threads
+    Mat _map1 = map1.getMat(), _map2 = map2.getMat();
+    RectifyMapInvoker invoker(m, _map1, _map2);
+    parallel_for_(Range(0, size.height), invoker, size.area() / (double)(1 << 16));
+}
+
+void cv::omnidir::initUndistortRectifyMap(InputArray K, InputArray D, InputArray xi, InputArray R, InputArray P,
+    const cv::Size& size, int m1type, OutputArray map1, OutputArray map2, int flags, const Size& imageSize,
+    OutputArray mask, OutputArray spans)
+{
+    CV_Assert( m1type == CV_16SC2 || m1type == CV_32F || m1type <=0 );
+    CV_Assert(imageSize.area() != 0);
+
+    RectifyParams m;
+    getRectifyParams(K, D, xi, R, P, flags, m);
+    setTrigTables(m, size);
+
+    map1.create( size, m1type <= 0 ? CV_16SC2 : m1type );
+    map2.create( size, map1.type() == CV_16SC2 ? CV_16UC1 : CV_32F );
+    mask.create(size, CV_8U);
+
+    // the mask is derived from the map pixels as they are stored, row by row with the maps
+    Mat _map1 = map1.getMat(), _map2 = map2.getMat(), _mask = mask.getMat();
+    RectifyMapInvoker invoker(m, _map1, _map2, _mask, imageSize);
+    parallel_for_(Range(0, size.height), invoker, size.area() / (double)(1 << 16));
+
+    if (spans.needed())
+    {
+        std::vector<Vec3i> _spans;
+        getMaskSpans(_mask, _spans);
+        Mat(_spans).copyTo(spans);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// cv::omnidir::initUndistortRectifyMapCoarse
+
+void cv::omnidir::initUndistortRectifyMapCoarse(InputArray K, InputArray D, InputArray xi, InputArray R, InputArray P,
+    const cv::Size& size, int m1type, OutputArray map1, OutputArray map2, int flags, int gridStep, double maxError,
+    OutputArray cellError)
+{
+    CV_Assert( m1type == CV_16SC2 || m1type == CV_32F || m1type <=0 );
+    CV_Assert(gridStep >= 1 && maxError >= 0);
+
+    RectifyParams m;
+    getRectifyParams(K, D, xi, R, P, flags, m);
+    setTrigTables(m, size);
+
+    map1.create( size, m1type <= 0 ? CV_16SC2 : m1type );
+    map2.create( size, map1.type() == CV_16SC2 ? CV_16UC1 : CV_32F );
+
+    // the exact map at the nodes, the last ones at or past the last row and column
+    Size cells((size.width - 1) / gridStep + 1, (size.height - 1) / gridStep + 1);
+    Mat nodes(cells.height + 1, cells.width + 1, CV_64FC2);
+    for (int i = 0; i < nodes.rows; ++i)
+    {
+        Vec2d* n = nodes.ptr<Vec2d>(i);
+        for (int j = 0; j < nodes.cols; ++j)
+            n[j] = projectRay(m, rectifyRay(m, j*gridStep, i*gridStep));
+    }
+
+    Mat _cellError;
+    if (cellError.needed())
+    {
+        cellError.create(cells, CV_32F);
+        _cellError = cellError.getMat();
+    }
+
+    Mat _map1 = map1.getMat(), _map2 = map2.getMat();
+    CoarseRectifyMapInvoker invoker(m, nodes, gridStep, maxError, _map1, _map2, _cellError);
+    parallel_for_(Range(0, cells.height), invoker, size.area() / (double)(1 << 16));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// cv::omnidir::initUndistortRectifyMapROI
+
+cv::Rect cv::omnidir::initUndistortRectifyMapROI(InputArray K, InputArray D, InputArray xi, InputArray R, InputArray P,
+    const Rect& roi, const Size& imageSize, int m1type, OutputArray map1, OutputArray map2, int flags, bool relative)
+{
+    CV_Assert( m1type == CV_16SC2 || m1type == CV_32F || m1type <=0 );
+    CV_Assert(roi.x >= 0 && roi.y >= 0 && roi.area() != 0);
+
+    RectifyParams m;
+    getRectifyParams(K, D, xi, R, P, flags, m);
+    setTrigTables(m, Size(roi.x + roi.width, roi.y + roi.height));
+
+    map1.create( roi.size(), m1type <= 0 ? CV_16SC2 : m1type );
+    map2.create( roi.size(), map1.type() == CV_16SC2 ? CV_16UC1 : CV_32F );
+
+    Mat _map1 = map1.getMat(), _map2 = map2.getMat();
+    RectifyMapInvoker invoker(m, _map1, _map2, roi.tl());
+    parallel_for_(Range(0, roi.height), invoker, roi.area() / (double)(1 << 16));
+
+    // the footprint of bands of rows, and the pixel after it that INTER_LINEAR reads
+    std::vector<Rect> bands, sources;
+    for (int y = 0; y < roi.height; y += 16)
+        bands.push_back(Rect(0, y, roi.width, std::min(16, roi.height - y)));
+    sources.resize(bands.size());
+    TileFootprintInvoker footprints(_map1, _map2, bands, sources);
+    parallel_for_(Range(0, (int)bands.size()), footprints, roi.area() / (double)(1 << 16));
+
+    Rect box;
+    for (size_t i = 0; i < sources.size(); ++i)
+    {
+        if (sources[i].area() != 0)
+            box = box.area() != 0 ? box | sources[i] : sources[i];
+    }
+    if (box.area() != 0)
+        box = Rect(box.x, box.y, box.width + 1, box.height + 1) & Rect(Point(), imageSize);
+
+    if (relative && box.area() != 0)
+    {
+        if (_map1.type() == CV_16SC2)
+            _map1 -= Scalar(box.x, box.y);
+        else
+        {
+            _map1 -= Scalar(box.x);
+            _map2 -= Scalar(box.y);
+        }
+    }
+    return box;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// cv::omnidir::initUndistortRectifyMapPyramid
+
+namespace cv { namespace
+{
+    // The pixels (step*x, step*y) of map, which is the map of a level of the pyramid step times coarser
+    template <typename T>
+    void subsampleMap(const Mat& map, int step, Mat& dst)
+    {
+        for (int i = 0; i < dst.rows; ++i)
+        {
+            const T* src = map.ptr<T>(i*step);
+            T* d = dst.ptr<T>(i);
+            for (int j = 0; j < dst.cols; ++j)
+                d[j] = src[j*step];
+        }
+    }
+
+    void subsampleMap(const Mat& map, int step, Mat& dst)
+    {
+        CV_Assert(map.elemSize() == 2 || map.elemSize() == 4);
+        if (map.elemSize() == 2)
+            subsampleMap<ushort>(map, step, dst);
+        else
+            subsampleMap<int>(map, step, dst);
+    }
+}}
+
+void cv::omnidir::initUndistortRectifyMapPyramid(InputArray K, InputArray D, InputArray xi, InputArray R,
+    InputArray P, const Size& size, int m1type, OutputArrayOfArrays map1, OutputArrayOfArrays map2, int flags,
+    int maxLevel)
+{
+    CV_Assert(maxLevel >= 0 && maxLevel < 31);
+
+    Mat fine1, fine2;
+    initUndistortRectifyMap(K, D, xi, R, P, size, m1type, fine1, fine2, flags);
+
+    map1.create(maxLevel + 1, 1, fine1.type(), -1);
+    map2.create(maxLevel + 1, 1, fine2.type(), -1);
+    map1.create(size, fine1.type(), 0);
+    map2.create(size, fine2.type(), 0);
+    fine1.copyTo(map1.getMat(0));
+    fine2.copyTo(map2.getMat(0));
+
+    // every level from level 0 directly, the pixel (x, y) of level l is its pixel (2^l x, 2^l y)
+    Size levelSize = size;
+    for (int l = 1; l <= maxLevel; ++l)
+    {
+        levelSize = Size((levelSize.width + 1) / 2, (levelSize.height + 1) / 2);
+        map1.create(levelSize, fine1.type(), l);
+        map2.create(levelSize, fine2.type(), l);
+        Mat level1 = map1.getMat(l), level2 = map2.getMat(l);
+        subsampleMap(fine1, 1 << l, level1);
+        subsampleMap(fine2, 1 << l, level2);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// cv::omnidir::rectifyImage
+
+void cv::omnidir::rectifyImage(InputArray distorted, OutputArray undistorted, InputArray K, InputArray D, InputArray xi,
+    int flags, InputArray Knew, const Size& new_size, InputArray R, int interpolation, int borderMode)
+{
+    Size size = new_size.area() != 0 ? new_size : distorted.size();
+
+    RectifyParams m;
+    getRectifyParams(K, D, xi, R, Knew, flags, m);
+    setTrigTables(m, size);
+
+    Mat src = distorted.getMat();
+    undistorted.create(size, src.type());
+    Mat dst = undistorted.getMat();
+    CV_Assert(src.data != dst.data);
+
+    int tiles = ((size.width + FUSED_TILE_WIDTH - 1) / FUSED_TILE_WIDTH)
+        * ((size.height + FUSED_TILE_HEIGHT - 1) / FUSED_TILE_HEIGHT);
+    FusedRemapInvoker invoker(m, src, dst, interpolation, borderMode);
+    parallel_for_(Range(0, tiles), invoker);
+}
+
+void cv::omnidir::undistortImageROI(InputArray distorted, OutputArray undistorted, InputArray K, InputArray D,
+    InputArray xi, int flags, InputArray Knew, const Rect& roi, InputArray R, int interpolation, int borderMode)
+{
+    CV_Assert(roi.x >= 0 && roi.y >= 0 && roi.area() != 0);
+
+    RectifyParams m;
+    getRectifyParams(K, D, xi, R, Knew, flags, m);
+    setTrigTables(m, Size(roi.x + roi.width, roi.y + roi.height));
+
+    Mat src = distorted.getMat();
+    undistorted.create(roi.size(), src.type());
+    Mat dst = undistorted.getMat();
+    CV_Assert(src.data != dst.data);
+
+    int tiles = ((roi.width + FUSED_TILE_WIDTH - 1) / FUSED_TILE_WIDTH)
+        * ((roi.height + FUSED_TILE_HEIGHT - 1) / FUSED_TILE_HEIGHT);
+    FusedRemapInvoker invoker(m, src, dst, interpolation, borderMode, roi.tl());
+    parallel_for_(Range(0, tiles), invoker);
+}
+
+namespace cv { namespace
+{
+    // Side of the tiles of a coarse level of undistortImagePyramid that are remapped from one source level
+    const int PYRAMID_TILE_SIZE = 64;
+
+    // Pixels of the source per pixel of the CV_32F maps mapx, mapy around (x, y), as the square root of the area
+    // of the source a pixel covers
+    double getMapScale(const Mat& mapx, const Mat& mapy, int x, int y)
+    {
+        int x0 = std::max(x - 1, 0), x1 = std::min(x + 1, mapx.cols - 1);
+        int y0 = std::max(y - 1, 0), y1 = std::min(y + 1, mapx.rows - 1);
+        if (x0 == x1 || y0 == y1)
+            return 1;
+
+        double ux = (mapx.at<float>(y, x1) - mapx.at<float>(y, x0)) / (x1 - x0),
+            vx = (mapy.at<float>(y, x1) - mapy.at<float>(y, x0)) / (x1 - x0),
+            uy = (mapx.at<float>(y1, x) - mapx.at<float>(y0, x)) / (y1 - y0),
+            vy = (mapy.at<float>(y1, x) - mapy.at<float>(y0, x)) / (y1 - y0);
+        return std::sqrt(std::abs(ux * vy - vx * uy));
+    }
 }}
 
-/////////////////////////////////////////////////////////////////////////////
-//////// projectPoints
-void cv::omnidir::projectPoints(InputArray objectPoints, OutputArray imagePoints,
-                InputArray rvec, InputArray tvec, InputArray K, double xi, InputArray D, OutputArray jacobian)
+void cv::omnidir::undistortImagePyramid(InputArray distorted, OutputArrayOfArrays undistorted, InputArray K,
+    InputArray D, InputArray xi, int flags, InputArray Knew, int maxLevel, const Size& new_size, InputArray R,
+    int interpolation, int borderMode)
 {
+    Size size = new_size.area() != 0 ? new_size : distorted.size();
 
-    CV_Assert(objectPoints.type() == CV_64FC3 || objectPoints.type() == CV_32FC3);
-    CV_Assert((rvec.depth() == CV_64F || rvec.depth() == CV_32F) && rvec.total() == 3);
-    CV_Assert((tvec.depth() == CV_64F || tvec.depth() == CV_32F) && tvec.total() == 3);
-    CV_Assert((K.type() == CV_64F || K.type() == CV_32F) && K.size() == Size(3,3));
-    CV_Assert((D.type() == CV_64F || D.type() == CV_32F) && D.total() == 4);
+    std::vector<Mat> map1, map2, srcPyramid;
+    initUndistortRectifyMapPyramid(K, D, xi, R, Knew, size, CV_32F, map1, map2, flags, maxLevel);
+
+    Mat src = distorted.getMat();
+    buildPyramid(src, srcPyramid, maxLevel);
+    undistorted.create(maxLevel + 1, 1, src.type(), -1);
+    undistorted.create(size, src.type(), 0);
+    Mat dst0 = undistorted.getMat(0);
+    CV_Assert(src.data != dst0.data);
+    remap(src, dst0, map1[0], map2[0], interpolation, borderMode);
+
+    // a pixel of level l covers 2^l pixels of level 0, that is 2^l times the map scale in pixels of distorted,
+    // which is about the filter of level s = l + log2(scale) of the source pyramid. The pixel (x, y) of that
+    // level is centred on the pixel (2^s x, 2^s y) of distorted, so the maps of the tile are halved s times.
+    for (int l = 1; l <= maxLevel; ++l)
+    {
+        undistorted.create(map1[l].size(), src.type(), l);
+        Mat dst = undistorted.getMat(l);
+        CV_Assert(src.data != dst.data);
+        for (int y = 0; y < dst.rows; y += PYRAMID_TILE_SIZE)
+        {
+            for (int x = 0; x < dst.cols; x += PYRAMID_TILE_SIZE)
+            {
+                Rect tile(x, y, std::min(PYRAMID_TILE_SIZE, dst.cols - x), std::min(PYRAMID_TILE_SIZE, dst.rows - y));
+                double scale = getMapScale(map1[0], map2[0], std::min((x + tile.width / 2) << l, size.width - 1),
+                    std::min((y + tile.height / 2) << l, size.height - 1));
+                int level = scale > 0 ? cvRound(l + std::log(scale) / std::log(2.)) : l;
+                level = std::min(std::max(level, 0), maxLevel);
+
+                Mat tileDst = dst(tile), tile1 = map1[l](tile) * (1. / (1 << level)),
+                    tile2 = map2[l](tile) * (1. / (1 << level));
+                remap(srcPyramid[level], tileDst, tile1, tile2, interpolation, borderMode);
+            }
+        }
+    }
+}
 
-    imagePoints.create(objectPoints.size(), CV_MAKETYPE(objectPoints.depth(), 2));
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// cv::omnidir::undistortImage
 
-    int n = (int)objectPoints.total();
+namespace cv { namespace
+{
+    // The parameters of an Undistorter, in the form it keeps them
+    struct UndistorterKey
+    {
+        Matx33d K, Knew, R;
+        Vec4d D;
+        double xi;
+        int flags;
+        Size newSize;
 
-    Vec3d om = rvec.depth() == CV_32F ? (Vec3d)*rvec.getMat().ptr<Vec3f>() : *rvec.getMat().ptr<Vec3d>();
-    Vec3d T  = tvec.depth() == CV_32F ? (Vec3d)*tvec.getMat().ptr<Vec3f>() : *tvec.getMat().ptr<Vec3d>();
+        bool operator==(const UndistorterKey& k) const
+        {
+            return K == k.K && Knew == k.Knew && R == k.R && D == k.D && xi == k.xi && flags == k.flags
+                && newSize == k.newSize;
+        }
+    };
+
+    void getUndistorterKey(InputArray K, InputArray D, InputArray xi, int flags, InputArray Knew, const Size& new_size,
+        InputArray R, UndistorterKey& key)
+    {
+        CV_Assert(K.size() == Size(3, 3) && (K.depth() == CV_32F || K.depth() == CV_64F));
+        CV_Assert(D.empty() || (D.total() == 4 && (D.depth() == CV_32F || D.depth() == CV_64F)));
+        CV_Assert(xi.total() == 1 && (xi.depth() == CV_32F || xi.depth() == CV_64F));
+        CV_Assert(Knew.empty() || Knew.size() == Size(3, 3) || Knew.size() == Size(4, 3));
+        CV_Assert(flags == omnidir::RECTIFY_PERSPECTIVE || flags == omnidir::RECTIFY_CYLINDRICAL
+            || flags == omnidir::RECTIFY_LONGLATI || flags == omnidir::RECTIFY_STEREOGRAPHIC);
+
+        K.getMat().convertTo(key.K, CV_64F);
+        if (Knew.empty())
+            key.Knew = key.K;
+        else
+            Knew.getMat().colRange(0, 3).convertTo(key.Knew, CV_64F);
+        getRotation(R, key.R);
+
+        key.D = Vec4d::all(0);
+        if (!D.empty())
+            key.D = D.depth() == CV_32F ? (Vec4d)*D.getMat().ptr<Vec4f>() : *D.getMat().ptr<Vec4d>();
+        key.xi = xi.depth() == CV_32F ? (double)*xi.getMat().ptr<float>() : *xi.getMat().ptr<double>();
+        key.flags = flags;
+        key.newSize = new_size;
+    }
+
+    // An Undistorter of the cache, built by the first caller that needs it under its own lock
+    struct UndistorterEntry
+    {
+        UndistorterEntry() : built(false) {}
+
+        cv::Mutex mutex;
+        bool built;
+        omnidir::Undistorter undistorter;
+    };
+
+    // The Undistorters of the last parameters undistortImage has seen, most recent first
+    const int UNDISTORTER_CACHE_SIZE = 4;
+
+    cv::Mutex undistorterCacheMutex;
+    std::list<std::pair<UndistorterKey, Ptr<UndistorterEntry> > > undistorterCache;
+}}
+
+void cv::omnidir::undistortImage(InputArray distorted, OutputArray undistorted,
+    InputArray K, InputArray D, InputArray xi, int flags, InputArray Knew, const Size& new_size, InputArray R)
+{
+    Size size = new_size.area() != 0 ? new_size : distorted.size();
+
+    UndistorterKey key;
+    getUndistorterKey(K, D, xi, flags, Knew, size, R, key);
+
+    // the cache lock only covers the lookup. The maps are built once per parameters under the lock of their
+    // entry, so that callers with other parameters are not held up, and shared by the copy that remaps.
+    Ptr<UndistorterEntry> entry;
+    {
+        cv::AutoLock lock(undistorterCacheMutex);
+        std::list<std::pair<UndistorterKey, Ptr<UndistorterEntry> > >::iterator it = undistorterCache.begin();
+        while (it != undistorterCache.end() && !(it->first == key))
+            ++it;
+
+        if (it != undistorterCache.end())
+            undistorterCache.splice(undistorterCache.begin(), undistorterCache, it);
+        else
+        {
+            undistorterCache.push_front(std::make_pair(key, makePtr<UndistorterEntry>()));
+            if ((int)undistorterCache.size() > UNDISTORTER_CACHE_SIZE)
+                undistorterCache.pop_back();
+        }
+        entry = undistorterCache.front().second;
+    }
+
+    Undistorter undistorter;
+    {
+        cv::AutoLock lock(entry->mutex);
+        if (!entry->built)
+        {
+            entry->undistorter.create(K, D, xi, flags, Knew, size, R);
+            entry->built = true;
+        }
+        undistorter = entry->undistorter;
+    }
+    undistorter.apply(distorted, undistorted);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// cv::omnidir::Undistorter
+
+cv::omnidir::Undistorter::Undistorter() : _xi(0), _flags(-1)
+{
+}
+
+cv::omnidir::Undistorter::Undistorter(InputArray K, InputArray D, InputArray xi, int flags, InputArray Knew,
+    const Size& new_size, InputArray R) : _xi(0), _flags(-1)
+{
+    create(K, D, xi, flags, Knew, new_size, R);
+}
+
+void cv::omnidir::Undistorter::create(InputArray K, InputArray D, InputArray xi, int flags, InputArray Knew,
+    const Size& new_size, InputArray R)
+{
+    UndistorterKey key;
+    getUndistorterKey(K, D, xi, flags, Knew, new_size, R, key);
+    _K = key.K;
+    _Knew = key.Knew;
+    _R = key.R;
+    _D = key.D;
+    _xi = key.xi;
+    _flags = key.flags;
+    _newSize = key.newSize;
+
+    _map1.release();
+    _map2.release();
+    if (_newSize.area() != 0)
+        createMaps(_newSize);
+}
+
+void cv::omnidir::Undistorter::createMaps(const Size& size)
+{
+    Mat xi(1, 1, CV_64F, Scalar(_xi));
+
+    String filename = rectifyMapCacheFile(_K, _D, xi, _R, _Knew, size, CV_16SC2, _flags);
+    if (!filename.empty() && loadRectifyMaps(filename, _K, _D, xi, _R, _Knew, size, CV_16SC2, _map1, _map2, _flags))
+        return;
+
+    omnidir::initUndistortRectifyMap(_K, _D, xi, _R, _Knew, size, CV_16SC2, _map1, _map2, _flags);
+    if (!filename.empty())
+        saveRectifyMaps(filename, _K, _D, xi, _R, _Knew, size, _map1, _map2, _flags);
+}
+
+void cv::omnidir::Undistorter::apply(InputArray distorted, OutputArray undistorted, int interpolation, int borderMode)
+{
+    CV_Assert(!empty());
+
+    Size size = _newSize.area() != 0 ? _newSize : distorted.size();
+    if (_map1.size() != size)
+        createMaps(size);
+    cv::remap(distorted, undistorted, _map1, _map2, interpolation, borderMode);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// cv::omnidir::CubemapRenderer
+
+namespace cv { namespace
+{
+    // Rows right, down and forward of the face rotations, in the order of the face enum
+    const double CUBEMAP_FACE_AXES[6][9] = {
+        { 0, 0,-1,   0, 1, 0,   1, 0, 0 },    // +X
+        { 0, 0, 1,   0, 1, 0,  -1, 0, 0 },    // -X
+        { 1, 0, 0,   0, 0,-1,   0, 1, 0 },    // +Y
+        { 1, 0, 0,   0, 0, 1,   0,-1, 0 },    // -Y
+        { 1, 0, 0,   0, 1, 0,   0, 0, 1 },    // +Z
+        {-1, 0, 0,   0, 1, 0,   0, 0,-1 }     // -Z
+    };
+
+    // Column and row of the faces in LAYOUT_CROSS, in face sizes
+    const int CUBEMAP_CROSS_CELLS[6][2] = { {2, 1}, {0, 1}, {1, 2}, {1, 0}, {1, 1}, {3, 1} };
+
+    // Rows of a face remapped by one task of CubemapRenderer::render
+    const int CUBEMAP_STRIPE_HEIGHT = 16;
+
+    // CubemapRenderer::render of a range of stripes, stripe s being the rows starting at stripes[s][1] of
+    // face stripes[s][0]
+    class CubemapRemapInvoker : public ParallelLoopBody
+    {
+    public:
+        CubemapRemapInvoker(const omnidir::CubemapRenderer& _renderer, const std::vector<Vec2i>& _stripes, int _layout,
+            const Mat& _src, Mat& _dst, int _interpolation, int _borderMode) : renderer(_renderer), stripes(_stripes),
+            layout(_layout), src(_src), dst(_dst), interpolation(_interpolation), borderMode(_borderMode)
+        {
+        }
+
+        virtual void operator()(const Range& range) const
+        {
+            const int n = renderer.faceSize();
+            for (int s = range.start; s < range.end; ++s)
+            {
+                int face = stripes[s][0], y = stripes[s][1];
+                int height = std::min(CUBEMAP_STRIPE_HEIGHT, n - y);
+                Rect rect = renderer.faceRect(face, layout);
+
+                Range rows(face*n + y, face*n + y + height);
+                Mat dstStripe = dst(Rect(rect.x, rect.y + y, n, height));
+                cv::remap(src, dstStripe, renderer.map1().rowRange(rows), renderer.map2().rowRange(rows),
+                    interpolation, borderMode);
+            }
+        }
+
+    private:
+        const omnidir::CubemapRenderer& renderer;
+        const std::vector<Vec2i>& stripes;
+        int layout;
+        const Mat& src;
+        Mat& dst;
+        int interpolation;
+        int borderMode;
+
+        CubemapRemapInvoker& operator=(const CubemapRemapInvoker&);
+    };
+}}
+
+cv::omnidir::CubemapRenderer::CubemapRenderer() : _faceSize(0)
+{
+}
+
+cv::omnidir::CubemapRenderer::CubemapRenderer(InputArray K, InputArray D, InputArray xi, int faceSize, InputArray R)
+    : _faceSize(0)
+{
+    create(K, D, xi, faceSize, R);
+}
+
+void cv::omnidir::CubemapRenderer::create(InputArray K, InputArray D, InputArray xi, int faceSize, InputArray R)
+{
+    CV_Assert(faceSize > 0);
+
+    getRotation(R, _R);
+    _faceSize = faceSize;
+
+    // 90 degrees across each face, the edges of the faces running through the centers of their outer pixels
+    Matx33d Knew(faceSize / 2.0, 0, (faceSize - 1) / 2.0,
+                 0, faceSize / 2.0, (faceSize - 1) / 2.0,
+                 0, 0, 1);
+
+    _map1.create(FACE_COUNT * faceSize, faceSize, CV_16SC2);
+    _map2.create(FACE_COUNT * faceSize, faceSize, CV_16UC1);
+    for (int face = 0; face < FACE_COUNT; ++face)
+    {
+        RectifyParams m;
+        getRectifyParams(K, D, xi, faceRotation(face), Knew, omnidir::RECTIFY_PERSPECTIVE, m);
+
+        Range rows(face * faceSize, (face + 1) * faceSize);
+        Mat map1 = _map1.rowRange(rows), map2 = _map2.rowRange(rows);
+        RectifyMapInvoker invoker(m, map1, map2);
+        parallel_for_(Range(0, faceSize), invoker, map1.total() / (double)(1 << 16));
+    }
+}
+
+cv::Matx33d cv::omnidir::CubemapRenderer::faceRotation(int face) const
+{
+    CV_Assert(0 <= face && face < FACE_COUNT);
+    return Matx33d(CUBEMAP_FACE_AXES[face]) * _R;
+}
+
+cv::Rect cv::omnidir::CubemapRenderer::faceRect(int face, int layout) const
+{
+    CV_Assert(0 <= face && face < FACE_COUNT);
+    CV_Assert(layout == LAYOUT_PACKED || layout == LAYOUT_CROSS);
+
+    if (layout == LAYOUT_PACKED)
+        return Rect(0, face * _faceSize, _faceSize, _faceSize);
+    return Rect(CUBEMAP_CROSS_CELLS[face][0] * _faceSize, CUBEMAP_CROSS_CELLS[face][1] * _faceSize, _faceSize, _faceSize);
+}
+
+void cv::omnidir::CubemapRenderer::render(InputArray distorted, OutputArray cubemap, int layout, int faces,
+    int interpolation, int borderMode) const
+{
+    CV_Assert(!empty());
+    CV_Assert(layout == LAYOUT_PACKED || layout == LAYOUT_CROSS);
+    CV_Assert((faces & ~ALL_FACES) == 0);
+
+    const int n = _faceSize;
+    Size size = layout == LAYOUT_PACKED ? Size(n, FACE_COUNT * n) : Size(4 * n, 3 * n);
+
+    Mat src = distorted.getMat();
+    bool reused = !cubemap.empty() && cubemap.size() == size && cubemap.type() == src.type();
+    cubemap.create(size, src.type());
+    Mat dst = cubemap.getMat();
+    CV_Assert(src.data != dst.data);
+    if (!reused)
+        dst.setTo(Scalar::all(0));
+
+    // the stripes of all faces are remapped in one parallel loop
+    std::vector<Vec2i> stripes;
+    for (int face = 0; face < FACE_COUNT; ++face)
+    {
+        if (faces & (1 << face))
+        {
+            for (int y = 0; y < n; y += CUBEMAP_STRIPE_HEIGHT)
+                stripes.push_back(Vec2i(face, y));
+        }
+    }
 
-    Vec2d f,c;
-    double s;
-    if (K.depth() == CV_32F)
+    CubemapRemapInvoker invoker(*this, stripes, layout, src, dst, interpolation, borderMode);
+    parallel_for_(Range(0, (int)stripes.size()), invoker);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// cv::omnidir::VirtualCamera
+
+cv::omnidir::VirtualCamera::VirtualCamera() : _xi(0)
+{
+}
+
+cv::omnidir::VirtualCamera::VirtualCamera(InputArray K, InputArray D, InputArray xi, int flags, InputArray Knew,
+    const Size& new_size) : _xi(0)
+{
+    create(K, D, xi, flags, Knew, new_size);
+}
+
+void cv::omnidir::VirtualCamera::create(InputArray K, InputArray D, InputArray xi, int flags, InputArray Knew,
+    const Size& new_size)
+{
+    CV_Assert(!Knew.empty() && new_size.area() != 0);
+
+    // the rays of rectifyRay without rotation
+    RectifyParams m;
+    getRectifyParams(K, D, xi, cv::noArray(), Knew, flags, m);
+
+    _rays.create(new_size, CV_32FC3);
+    for (int i = 0; i < new_size.height; ++i)
+    {
+        Vec3f* ray = _rays.ptr<Vec3f>(i);
+        for (int j = 0; j < new_size.width; ++j)
+            ray[j] = rectifyRay(m, j, i);
+    }
+
+    _K = Matx33d(m.f[0], m.s, m.c[0],
+                 0, m.f[1], m.c[1],
+                 0, 0, 1);
+    _D = m.kp;
+    _xi = m.xi;
+
+    _map1.create(new_size, CV_16SC2);
+    _map2.create(new_size, CV_16UC1);
+    setRotation(Matx33d::eye());
+}
+
+void cv::omnidir::VirtualCamera::setRotation(InputArray R)
+{
+    CV_Assert(!empty());
+
+    getRotation(R, _R);
+    RectifyParams m;
+    getRectifyParams(_K, _D, Matx<double, 1, 1>(_xi), _R, cv::noArray(), omnidir::RECTIFY_PERSPECTIVE, m);
+
+    RayMapInvoker invoker(m, _rays, _map1, _map2);
+    parallel_for_(Range(0, _map1.rows), invoker, _map1.total() / (double)(1 << 16));
+}
+
+void cv::omnidir::VirtualCamera::apply(InputArray distorted, OutputArray undistorted, int interpolation,
+    int borderMode) const
+{
+    CV_Assert(!empty());
+    cv::remap(distorted, undistorted, _map1, _map2, interpolation, borderMode);
+}
+
+void cv::omnidir::VirtualCamera::render(InputArray distorted, OutputArray undistorted, InputArray R, int interpolation,
+    int borderMode)
+{
+    CV_Assert(!empty());
+
+    getRotation(R, _R);
+    RectifyParams m;
+    getRectifyParams(_K, _D, Matx<double, 1, 1>(_xi), _R, cv::noArray(), omnidir::RECTIFY_PERSPECTIVE, m);
+
+    Mat src = distorted.getMat();
+    undistorted.create(_map1.size(), src.type());
+    Mat dst = undistorted.getMat();
+    CV_Assert(src.data != dst.data);
+
+    int tiles = ((dst.cols + FUSED_TILE_WIDTH - 1) / FUSED_TILE_WIDTH)
+        * ((dst.rows + FUSED_TILE_HEIGHT - 1) / FUSED_TILE_HEIGHT);
+    RayRemapInvoker invoker(m, _rays, _map1, _map2, src, dst, interpolation, borderMode);
+    parallel_for_(Range(0, tiles), invoker);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// cv::omnidir::ViewportRenderer
+
+namespace cv { namespace
+{
+    // Blocks of the source image by which tiles of the output are ordered
+    const int SOURCE_BLOCK = 64;
+
+    // Order of the source block of pixel (x, y), the blocks being numbered along a Z curve so that blocks with
+    // close numbers are close in both directions
+    inline int sourceBlockKey(int x, int y)
+    {
+        int bx = std::min(std::max(x, 0), (int)SHRT_MAX) / SOURCE_BLOCK;
+        int by = std::min(std::max(y, 0), (int)SHRT_MAX) / SOURCE_BLOCK;
+
+        int key = 0;
+        for (int bit = 0; (bx | by) >> bit; ++bit)
+            key |= (((bx >> bit) & 1) << (2*bit)) | (((by >> bit) & 1) << (2*bit + 1));
+        return key;
+    }
+
+    // Order of a tile and its position in the list, to keep the sort stable
+    typedef std::pair<int, int> TileKey;
+
+    // ViewportRenderer::render of a range of tiles
+    class ViewportRemapInvoker : public ParallelLoopBody
+    {
+    public:
+        ViewportRemapInvoker(const omnidir::ViewportRenderer& _renderer, const std::vector<Vec3i>& _tiles, const Mat& _src,
+            std::vector<Mat>& _dst, int _interpolation, int _borderMode) : renderer(_renderer), tiles(_tiles), src(_src),
+            dst(_dst), interpolation(_interpolation), borderMode(_borderMode)
+        {
+        }
+
+        virtual void operator()(const Range& range) const
+        {
+            for (int t = range.start; t < range.end; ++t)
+            {
+                int view = tiles[t][0];
+                Rect roi(tiles[t][1], tiles[t][2], FUSED_TILE_WIDTH, FUSED_TILE_HEIGHT);
+                roi &= Rect(0, 0, dst[view].cols, dst[view].rows);
+
+                Mat dstTile = dst[view](roi);
+                cv::remap(src, dstTile, renderer.map1(view)(roi), renderer.map2(view)(roi), interpolation, borderMode);
+            }
+        }
+
+    private:
+        const omnidir::ViewportRenderer& renderer;
+        const std::vector<Vec3i>& tiles;
+        const Mat& src;
+        std::vector<Mat>& dst;
+        int interpolation;
+        int borderMode;
+
+        ViewportRemapInvoker& operator=(const ViewportRemapInvoker&);
+    };
+}}
+
+cv::omnidir::ViewportRenderer::ViewportRenderer()
+{
+}
+
+cv::omnidir::ViewportRenderer::ViewportRenderer(InputArray K, InputArray D, InputArray xi,
+    const std::vector<Viewport>& viewports)
+{
+    create(K, D, xi, viewports);
+}
+
+void cv::omnidir::ViewportRenderer::create(InputArray K, InputArray D, InputArray xi,
+    const std::vector<Viewport>& viewports)
+{
+    CV_Assert(!viewports.empty());
+
+    _viewports = viewports;
+    _map1.resize(viewports.size());
+    _map2.resize(viewports.size());
+    for (size_t i = 0; i < viewports.size(); ++i)
+    {
+        CV_Assert(viewports[i].size.area() != 0);
+        omnidir::initUndistortRectifyMap(K, D, xi, viewports[i].R, viewports[i].Knew, viewports[i].size, CV_16SC2,
+            _map1[i], _map2[i], viewports[i].flags);
+    }
+
+    // the tiles are sorted by the block of the source their center reads
+    std::vector<Vec3i> tiles;
+    std::vector<TileKey> keys;
+    for (size_t i = 0; i < viewports.size(); ++i)
+    {
+        const Mat& map1 = _map1[i];
+        for (int y = 0; y < map1.rows; y += FUSED_TILE_HEIGHT)
+        {
+            for (int x = 0; x < map1.cols; x += FUSED_TILE_WIDTH)
+            {
+                Vec2s center = map1.at<Vec2s>(std::min(y + FUSED_TILE_HEIGHT / 2, map1.rows - 1),
+                    std::min(x + FUSED_TILE_WIDTH / 2, map1.cols - 1));
+
+                keys.push_back(TileKey(sourceBlockKey(center[0], center[1]), (int)tiles.size()));
+                tiles.push_back(Vec3i((int)i, x, y));
+            }
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+
+    _tiles.resize(tiles.size());
+    for (size_t t = 0; t < keys.size(); ++t)
+        _tiles[t] = tiles[keys[t].second];
+}
+
+void cv::omnidir::ViewportRenderer::render(InputArray distorted, OutputArrayOfArrays views, int interpolation,
+    int borderMode) const
+{
+    CV_Assert(!empty());
+
+    Mat src = distorted.getMat();
+    int n = (int)_viewports.size();
+    views.create(n, 1, src.type(), -1);
+
+    std::vector<Mat> dst(n);
+    for (int i = 0; i < n; ++i)
+    {
+        views.create(_viewports[i].size, src.type(), i);
+        dst[i] = views.getMat(i);
+        CV_Assert(src.data != dst[i].data);
+    }
+
+    // consecutive tiles read the same part of the source, so each thread takes runs of them
+    ViewportRemapInvoker invoker(*this, _tiles, src, dst, interpolation, borderMode);
+    parallel_for_(Range(0, (int)_tiles.size()), invoker, _tiles.size() / 16.0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// cv::omnidir::TiledRemapper
+
+namespace cv { namespace
+{
+    // Largest footprint of a tile worth fetching ahead, in multiples of the tile area
+    const int PREFETCH_MAX_AREA = 16;
+    const int PREFETCH_LINE_SIZE = 64;
+
+    // Asks for the pixels of r in src to be fetched into the cache, without waiting for them
+    inline void prefetchRect(const Mat& src, const Rect& r)
+    {
+#if defined __GNUC__
+        const size_t rowBytes = r.width*src.elemSize();
+        for (int i = r.y; i < r.y + r.height; ++i)
+        {
+            const uchar* p = src.ptr(i) + r.x*src.elemSize();
+            for (size_t k = 0; k < rowBytes; k += PREFETCH_LINE_SIZE)
+                __builtin_prefetch(p + k);
+        }
+#else
+        (void)src;
+        (void)r;
+#endif
+    }
+
+    // Pixels that the interpolation of cv::remap reads around the integer part of a source coordinate, before
+    // and after it
+    inline void getInterpolationMargins(int interpolation, int& before, int& after)
+    {
+        switch (interpolation)
+        {
+        case INTER_NEAREST: before = 0; after = 1; break;
+        case INTER_CUBIC: before = 1; after = 2; break;
+        case INTER_LANCZOS4: before = 3; after = 4; break;
+        default: before = 0; after = 1; break;
+        }
+    }
+
+    // TiledRemapper::remap of a range of tiles. Each tile fetches the footprint of the next one while it is
+    // remapped, when that footprint is compact.
+    class TiledRemapInvoker : public ParallelLoopBody
+    {
+    public:
+        TiledRemapInvoker(const omnidir::TiledRemapper& _remapper, const Mat& _src, Mat& _dst, int _interpolation,
+            int _borderMode, const Scalar& _borderValue) : remapper(_remapper), src(_src), dst(_dst),
+            interpolation(_interpolation), borderMode(_borderMode), borderValue(_borderValue)
+        {
+        }
+
+        virtual void operator()(const Range& range) const
+        {
+            int before, after;
+            getInterpolationMargins(interpolation, before, after);
+
+            for (int t = range.start; t < range.end; ++t)
+            {
+                if (t + 1 < range.end)
+                {
+                    Rect next = remapper.sourceRect(t + 1);
+                    if (next.area() <= PREFETCH_MAX_AREA * remapper.tile(t + 1).area())
+                    {
+                        next = Rect(next.x - before, next.y - before, next.width + before + after,
+                            next.height + before + after) & Rect(0, 0, src.cols, src.rows);
+                        prefetchRect(src, next);
+                    }
+                }
+
+                Rect roi = remapper.tile(t);
+                Mat dstTile = dst(roi);
+                cv::remap(src, dstTile, remapper.map1()(roi), remapper.map2().empty() ? Mat() : remapper.map2()(roi),
+                    interpolation, borderMode, borderValue);
+            }
+        }
+
+    private:
+        const omnidir::TiledRemapper& remapper;
+        const Mat& src;
+        Mat& dst;
+        int interpolation;
+        int borderMode;
+        Scalar borderValue;
+
+        TiledRemapInvoker& operator=(const TiledRemapInvoker&);
+    };
+}}
+
+cv::omnidir::TiledRemapper::TiledRemapper()
+{
+}
+
+cv::omnidir::TiledRemapper::TiledRemapper(InputArray map1, InputArray map2, const Size& tileSize)
+{
+    create(map1, map2, tileSize);
+}
+
+void cv::omnidir::TiledRemapper::create(InputArray map1, InputArray map2, const Size& tileSize)
+{
+    CV_Assert(tileSize.width > 0 && tileSize.height > 0);
+    CV_Assert(map1.type() == CV_16SC2 || (map1.type() == CV_32FC1 && map2.type() == CV_32FC1));
+    CV_Assert(map2.empty() || map2.size() == map1.size());
+    CV_Assert(!map1.empty());
+
+    _map1 = map1.getMat();
+    _map2 = map2.getMat();
+
+    std::vector<Rect> tiles;
+    for (int y = 0; y < _map1.rows; y += tileSize.height)
+        for (int x = 0; x < _map1.cols; x += tileSize.width)
+            tiles.push_back(Rect(x, y, tileSize.width, tileSize.height) & Rect(0, 0, _map1.cols, _map1.rows));
+
+    std::vector<Rect> sources(tiles.size());
+    TileFootprintInvoker invoker(_map1, _map2, tiles, sources);
+    parallel_for_(Range(0, (int)tiles.size()), invoker, _map1.total() / (double)(1 << 16));
+
+    // the tiles are sorted by the block of the center of their footprint, those without one last
+    std::vector<TileKey> keys(tiles.size());
+    for (size_t t = 0; t < tiles.size(); ++t)
     {
-        Matx33f Kc = K.getMat();
-        f = Vec2f(Kc(0,0), Kc(1,1));
-        c = Vec2f(Kc(0,2),Kc(1,2));
-        s = (double)Kc(0,1);
+        const Rect& r = sources[t];
+        keys[t] = TileKey(r.area() != 0 ? sourceBlockKey(r.x + r.width / 2, r.y + r.height / 2) : INT_MAX, (int)t);
     }
-    else
+    std::sort(keys.begin(), keys.end());
+
+    _tiles.resize(tiles.size());
+    _sources.resize(tiles.size());
+    for (size_t t = 0; t < keys.size(); ++t)
     {
-        Matx33d Kc = K.getMat();
-        f = Vec2d(Kc(0,0), Kc(1,1));
-        c = Vec2d(Kc(0,2),Kc(1,2));
-        s = Kc(0,1);
+        _tiles[t] = tiles[keys[t].second];
+        _sources[t] = sources[keys[t].second];
     }
+}
 
-    Vec4d kp = D.depth() == CV_32F ? (Vec4d)*D.getMat().ptr<Vec4f>() : *D.getMat().ptr<Vec4d>();
-    //Vec<double, 4> kp= (Vec<double,4>)*D.getMat().ptr<Vec<double,4> >();
+void cv::omnidir::TiledRemapper::remap(InputArray src, OutputArray dst, int interpolation, int borderMode,
+    const Scalar& borderValue) const
+{
+    CV_Assert(!empty());
 
-    const Vec3d* Xw_alld = objectPoints.getMat().ptr<Vec3d>();
-    const Vec3f* Xw_allf = objectPoints.getMat().ptr<Vec3f>();
-    Vec2d* xpd = imagePoints.getMat().ptr<Vec2d>();
-    Vec2f* xpf = imagePoints.getMat().ptr<Vec2f>();
+    Mat _src = src.getMat();
+    dst.create(_map1.size(), _src.type());
+    Mat _dst = dst.getMat();
+    CV_Assert(_src.data != _dst.data);
 
-    Matx33d R;
-    Matx<double, 3, 9> dRdom;
-    Rodrigues(om, R, dRdom);
+    // consecutive tiles read neighbouring parts of the source, so each thread takes runs of them
+    TiledRemapInvoker invoker(*this, _src, _dst, interpolation, borderMode, borderValue);
+    parallel_for_(Range(0, tiles()), invoker, tiles() / 16.0);
+}
 
-    JacobianRow *Jn = 0;
-    if (jacobian.needed())
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// cv::omnidir::CompactMap
+
+namespace cv { namespace
+{
+    // Fixed point source coordinates of element (y, x) of CV_16SC2 and CV_16UC1 maps, in 1/INTER_TAB_SIZE pixels
+    inline Vec2i getFixedPoint(const Mat& map1, const Mat& map2, int y, int x)
     {
-        int nvars = 2+2+1+4+3+3+1; // f,c,s,kp,om,T,xi
-        jacobian.create(2*int(n), nvars, CV_64F);
-        Jn = jacobian.getMat().ptr<JacobianRow>(0);
+        const short* xy = map1.ptr<short>(y) + 2*x;
+        int a = map2.ptr<ushort>(y)[x];
+        return Vec2i(xy[0]*INTER_TAB_SIZE + (a & (INTER_TAB_SIZE - 1)),
+                     xy[1]*INTER_TAB_SIZE + ((a >> INTER_BITS) & (INTER_TAB_SIZE - 1)));
     }
 
-    double k1=kp[0],k2=kp[1];
-    double p1 = kp[2], p2 = kp[3];
+    // Fixed point coordinates of the columns [x0, x1) of row y interpolated bilinearly between the nodes of a
+    // grid of step 1 << shift. It is done in integers, the weights summing to 1 << 2*shift, so that encoding and
+    // decoding agree exactly; the products stay below 2^31 for steps up to 16.
+    inline void predictCompactRow(const Mat& nodes, int shift, int y, int x0, int x1, Vec2i* predicted)
+    {
+        const int step = 1 << shift, half = 1 << (2*shift - 1);
+        const int cy = y >> shift, fy = y - (cy << shift);
+        const Vec2i* n0 = nodes.ptr<Vec2i>(cy);
+        const Vec2i* n1 = nodes.ptr<Vec2i>(cy + 1);
+        for (int x = x0; x < x1; ++x)
+        {
+            int cx = x >> shift, fx = x - (cx << shift);
+            for (int k = 0; k < 2; ++k)
+            {
+                int left = n0[cx][k]*(step - fy) + n1[cx][k]*fy;
+                int right = n0[cx + 1][k]*(step - fy) + n1[cx + 1][k]*fy;
+                predicted[x - x0][k] = (left*(step - fx) + right*fx + half) >> (2*shift);
+            }
+        }
+    }
 
-    for (int i = 0; i < n; i++)
+    // Decodes the columns [x0, x1) of row y of a CompactMap into rows of CV_16SC2 and CV_16UC1 maps
+    inline void decodeCompactRow(const omnidir::CompactMap& cm, int y, int x0, int x1, short* xy, ushort* a)
     {
-        // convert to camera coordinate
-        Vec3d Xw = objectPoints.depth() == CV_32F ? (Vec3d)Xw_allf[i] : Xw_alld[i];
+        int shift = 0;
+        while ((1 << shift) < cm.gridStep())
+            ++shift;
 
-        Vec3d Xc = (Vec3d)(R*Xw + T);
+        const int BLOCK = 64;
+        Vec2i predicted[BLOCK];
 
-        // convert to unit sphere
-        Vec3d Xs = Xc/cv::norm(Xc);
+        const int cy = y >> shift, fy = y - (cy << shift);
+        const int* cells = cm.cells().ptr<int>(cy);
+        const schar* deltas = cm.deltas().ptr<schar>(y);
+        for (int j0 = x0; j0 < x1; j0 += BLOCK)
+        {
+            int n = std::min(BLOCK, x1 - j0);
+            predictCompactRow(cm.nodes(), shift, y, j0, j0 + n, predicted);
+            for (int j = 0; j < n; ++j)
+            {
+                int x = j0 + j, cx = x >> shift;
+                Vec2i p;
+                if (cells[cx] < 0)
+                    p = Vec2i(predicted[j][0] + deltas[2*x], predicted[j][1] + deltas[2*x + 1]);
+                else
+                    p = cm.exact().ptr<Vec2i>()[cells[cx] + (fy << shift) + x - (cx << shift)];
+
+                int i = x - x0;
+                xy[2*i] = saturate_cast<short>(p[0] >> INTER_BITS);
+                xy[2*i + 1] = saturate_cast<short>(p[1] >> INTER_BITS);
+                a[i] = (ushort)(((p[1] & (INTER_TAB_SIZE - 1)) << INTER_BITS) + (p[0] & (INTER_TAB_SIZE - 1)));
+            }
+        }
+    }
 
-        // convert to normalized image plane
-        Vec2d xu = Vec2d(Xs[0]/(Xs[2]+xi), Xs[1]/(Xs[2]+xi));
+    // CompactMap::create of a range of cell rows: the corrections of the pixels, and the cells whose
+    // corrections do not fit in 8 bits marked with 1
+    class CompactEncodeInvoker : public ParallelLoopBody
+    {
+    public:
+        CompactEncodeInvoker(const Mat& _map1, const Mat& _map2, const Mat& _nodes, int _shift, Mat& _deltas,
+            Mat& _overflow) : map1(_map1), map2(_map2), nodes(_nodes), shift(_shift), deltas(_deltas), overflow(_overflow)
+        {
+        }
 
-        // add distortion
-        Vec2d xd;
-        double r2 = xu[0]*xu[0]+xu[1]*xu[1];
-        double r4 = r2*r2;
+        virtual void operator()(const Range& range) const
+        {
+            std::vector<Vec2i> predicted(map1.cols);
+            for (int cy = range.start; cy < range.end; ++cy)
+            {
+                int* flags = overflow.ptr<int>(cy);
+                for (int y = cy << shift; y < std::min((cy + 1) << shift, map1.rows); ++y)
+                {
+                    predictCompactRow(nodes, shift, y, 0, map1.cols, &predicted[0]);
+                    schar* d = deltas.ptr<schar>(y);
+                    for (int x = 0; x < map1.cols; ++x)
+                    {
+                        Vec2i delta = getFixedPoint(map1, map2, y, x) - predicted[x];
+                        if (delta[0] < SCHAR_MIN || delta[0] > SCHAR_MAX || delta[1] < SCHAR_MIN || delta[1] > SCHAR_MAX)
+                            flags[x >> shift] = 1;
+                        d[2*x] = saturate_cast<schar>(delta[0]);
+                        d[2*x + 1] = saturate_cast<schar>(delta[1]);
+                    }
+                }
+            }
+        }
 
-        xd[0] = xu[0]*(1+k1*r2+k2*r4) + 2*p1*xu[0]*xu[1] + p2*(r2+2*xu[0]*xu[0]);
-        xd[1] = xu[1]*(1+k1*r2+k2*r4) + p1*(r2+2*xu[1]*xu[1]) + 2*p2*xu[0]*xu[1];
+    private:
+        const Mat& map1;
+        const Mat& map2;
+        const Mat& nodes;
+        int shift;
+        Mat& deltas;
+        Mat& overflow;
 
-        // convert to pixel coordinate
-        Vec2d final;
-        final[0] = f[0]*xd[0]+s*xd[1]+c[0];
-        final[1] = f[1]*xd[1]+c[1];
+        CompactEncodeInvoker& operator=(const CompactEncodeInvoker&);
+    };
 
-        if (objectPoints.depth() == CV_32F)
+    // CompactMap::remap of a range of tiles, numbered row by row as in FusedRemapInvoker. The maps of a tile are
+    // decoded into buffers on the stack and consumed at once by cv::remap of that tile.
+    class CompactRemapInvoker : public ParallelLoopBody
+    {
+    public:
+        CompactRemapInvoker(const omnidir::CompactMap& _cm, const Mat& _src, Mat& _dst, int _interpolation,
+            int _borderMode, const Scalar& _borderValue) : cm(_cm), src(_src), dst(_dst), interpolation(_interpolation),
+            borderMode(_borderMode), borderValue(_borderValue)
         {
-            xpf[i] = final;
         }
-        else
+
+        virtual void operator()(const Range& range) const
         {
-            xpd[i] = final;
-        }
-        /*xpd[i][0] = f[0]*xd[0]+s*xd[1]+c[0];
-        xpd[i][1] = f[1]*xd[1]+c[1];*/
-
-        if (jacobian.needed())
-        {
-            double dXcdR_a[] = {Xw[0],Xw[1],Xw[2],0,0,0,0,0,0,
-                                0,0,0,Xw[0],Xw[1],Xw[2],0,0,0,
-                                0,0,0,0,0,0,Xw[0],Xw[1],Xw[2]};
-            Matx<double,3, 9> dXcdR(dXcdR_a);
-            Matx33d dXcdom = dXcdR * dRdom.t();
-            double r_1 = 1.0/norm(Xc);
-            double r_3 = pow(r_1,3);
-            Matx33d dXsdXc(r_1-Xc[0]*Xc[0]*r_3, -(Xc[0]*Xc[1])*r_3, -(Xc[0]*Xc[2])*r_3,
-                           -(Xc[0]*Xc[1])*r_3, r_1-Xc[1]*Xc[1]*r_3, -(Xc[1]*Xc[2])*r_3,
-                           -(Xc[0]*Xc[2])*r_3, -(Xc[1]*Xc[2])*r_3, r_1-Xc[2]*Xc[2]*r_3);
-            Matx23d dxudXs(1/(Xs[2]+xi),    0,    -Xs[0]/(Xs[2]+xi)/(Xs[2]+xi),
-                           0,    1/(Xs[2]+xi),    -Xs[1]/(Xs[2]+xi)/(Xs[2]+xi));
-            // pre-compute some reusable things
-            double temp1 = 2*k1*xu[0] + 4*k2*xu[0]*r2;
-            double temp2 = 2*k1*xu[1] + 4*k2*xu[1]*r2;
-            Matx22d dxddxu(k2*r4+6*p2*xu[0]+2*p1*xu[1]+xu[0]*temp1+k1*r2+1,    2*p1*xu[0]+2*p2*xu[1]+xu[0]*temp2,
-                           2*p1*xu[0]+2*p2*xu[1]+xu[1]*temp1,    k2*r4+2*p2*xu[0]+6*p1*xu[1]+xu[1]*temp2+k1*r2+1);
-            Matx22d dxpddxd(f[0], s,
-                            0, f[1]);
-            Matx23d dxpddXc = dxpddxd * dxddxu * dxudXs * dXsdXc;
-
-            // derivative of xpd respect to om
-            Matx23d dxpddom = dxpddXc * dXcdom;
-            Matx33d dXcdT(1.0,0.0,0.0,
-                          0.0,1.0,0.0,
-                          0.0,0.0,1.0);
-            // derivative of xpd respect to T
-
-            Matx23d dxpddT = dxpddXc * dXcdT;
-            Matx21d dxudxi(-Xs[0]/(Xs[2]+xi)/(Xs[2]+xi),
-                           -Xs[1]/(Xs[2]+xi)/(Xs[2]+xi));
-
-            // derivative of xpd respect to xi
-            Matx21d dxpddxi = dxpddxd * dxddxu * dxudxi;
-            Matx<double,2,4> dxddkp(xu[0]*r2, xu[0]*r4, 2*xu[0]*xu[1], r2+2*xu[0]*xu[0],
-                                    xu[1]*r2, xu[1]*r4, r2+2*xu[1]*xu[1], 2*xu[0]*xu[1]);
-
-            // derivative of xpd respect to kp
-            Matx<double,2,4> dxpddkp = dxpddxd * dxddkp;
-
-            // derivative of xpd respect to f
-            Matx22d dxpddf(xd[0], 0,
-                           0, xd[1]);
-
-            // derivative of xpd respect to c
-            Matx22d dxpddc(1, 0,
-                           0, 1);
-
-            Jn[0].dom = dxpddom.row(0);
-            Jn[1].dom = dxpddom.row(1);
-            Jn[0].dT = dxpddT.row(0);
-            Jn[1].dT = dxpddT.row(1);
-            Jn[0].dkp = dxpddkp.row(0);
-            Jn[1].dkp = dxpddkp.row(1);
-            Jn[0].dxi = dxpddxi(0,0);
-            Jn[1].dxi = dxpddxi(1,0);
-            Jn[0].df = dxpddf.row(0);
-            Jn[1].df = dxpddf.row(1);
-            Jn[0].dc = dxpddc.row(0);
-            Jn[1].dc = dxpddc.row(1);
-            Jn[0].ds = xd[1];
-            Jn[1].ds = 0;
-            Jn += 2;
-         }
-    }
+            short xy[FUSED_TILE_WIDTH*FUSED_TILE_HEIGHT*2];
+            ushort a[FUSED_TILE_WIDTH*FUSED_TILE_HEIGHT];
+
+            const int tilesX = (dst.cols + FUSED_TILE_WIDTH - 1) / FUSED_TILE_WIDTH;
+            for (int t = range.start; t < range.end; ++t)
+            {
+                Rect roi((t % tilesX) * FUSED_TILE_WIDTH, (t / tilesX) * FUSED_TILE_HEIGHT, FUSED_TILE_WIDTH, FUSED_TILE_HEIGHT);
+                roi &= Rect(0, 0, dst.cols, dst.rows);
+
+                Mat map1(roi.size(), CV_16SC2, xy), map2(roi.size(), CV_16UC1, a);
+                for (int i = 0; i < roi.height; ++i)
+                    decodeCompactRow(cm, roi.y + i, roi.x, roi.x + roi.width, map1.ptr<short>(i), map2.ptr<ushort>(i));
+
+                Mat dstTile = dst(roi);
+                cv::remap(src, dstTile, map1, map2, interpolation, borderMode, borderValue);
+            }
+        }
+
+    private:
+        const omnidir::CompactMap& cm;
+        const Mat& src;
+        Mat& dst;
+        int interpolation;
+        int borderMode;
+        Scalar borderValue;
+
+        CompactRemapInvoker& operator=(const CompactRemapInvoker&);
+    };
+}}
+
+cv::omnidir::CompactMap::CompactMap() : _shift(0)
+{
 }
 
-/////////////////////////////////////////////////////////////////////////////
-//////// undistortPoints
-void cv::omnidir::undistortPoints( InputArray distorted, OutputArray undistorted,
-    InputArray K, InputArray D, InputArray xi, InputArray R)
+void cv::omnidir::CompactMap::create(InputArray K, InputArray D, InputArray xi, InputArray R, InputArray P,
+    const Size& size, int flags, int gridStep)
 {
-    CV_Assert(distorted.type() == CV_64FC2 || distorted.type() == CV_32FC2);
-    CV_Assert(R.empty() || (!R.empty() && (R.size() == Size(3, 3) || R.total() * R.channels() == 3)
-        && (R.depth() == CV_64F || R.depth() == CV_32F)));
-    CV_Assert((D.depth() == CV_64F || D.depth() == CV_32F) && D.total() == 4);
-    CV_Assert(K.size() == Size(3, 3) && (K.depth() == CV_64F || K.depth() == CV_32F));
-    CV_Assert(xi.total() == 1 && (xi.depth() == CV_64F || xi.depth() == CV_32F));
+    Mat map1, map2;
+    omnidir::initUndistortRectifyMap(K, D, xi, R, P, size, CV_16SC2, map1, map2, flags);
+    create(map1, map2, gridStep);
+}
 
-    undistorted.create(distorted.size(), distorted.type());
+void cv::omnidir::CompactMap::create(InputArray map1, InputArray map2, int gridStep)
+{
+    CV_Assert(gridStep == 2 || gridStep == 4 || gridStep == 8 || gridStep == 16);
+    CV_Assert(!map1.empty());
 
-    cv::Vec2d f, c;
-    double s = 0.0;
-    if (K.depth() == CV_32F)
+    Mat m1 = map1.getMat(), m2 = map2.getMat();
+    CV_Assert(m2.empty() || m2.size() == m1.size());
+    if (m1.type() == CV_16SC2 && m2.empty())
     {
-        Matx33f camMat = K.getMat();
-        f = Vec2f(camMat(0,0), camMat(1,1));
-        c = Vec2f(camMat(0,2), camMat(1,2));
-        s = (double)camMat(0,1);
+        // nearest neighbour maps of cv::remap, whose fractions are all zero
+        m2 = Mat::zeros(m1.size(), CV_16UC1);
     }
-    else if (K.depth() == CV_64F)
+    else if (m1.type() != CV_16SC2 || m2.type() != CV_16UC1)
     {
-        Matx33d camMat = K.getMat();
-        f = Vec2d(camMat(0,0), camMat(1,1));
-        c = Vec2d(camMat(0,2), camMat(1,2));
-        s = camMat(0,1);
+        Mat fixed1, fixed2;
+        cv::convertMaps(m1, m2, fixed1, fixed2, CV_16SC2);
+        m1 = fixed1;
+        m2 = fixed2;
     }
 
-    Vec4d kp = D.depth()==CV_32F ? (Vec4d)*D.getMat().ptr<Vec4f>():(Vec4d)*D.getMat().ptr<Vec4d>();
-    Vec2d k = Vec2d(kp[0], kp[1]);
-    Vec2d p = Vec2d(kp[2], kp[3]);
+    _shift = gridStep == 2 ? 1 : gridStep == 4 ? 2 : gridStep == 8 ? 3 : 4;
+    Size cells((m1.cols + gridStep - 1) / gridStep, (m1.rows + gridStep - 1) / gridStep);
 
-    double _xi = xi.depth() == CV_32F ? (double)*xi.getMat().ptr<float>() : *xi.getMat().ptr<double>();
-    cv::Matx33d RR = cv::Matx33d::eye();
-    // R is om
-    if(!R.empty() && R.total()*R.channels() == 3)
-    {
-        cv::Vec3d rvec;
-        R.getMat().convertTo(rvec, CV_64F);
-        cv::Rodrigues(rvec, RR);
-    }
-    else if (!R.empty() && R.size() == Size(3,3))
+    // the nodes are the map at the corners of the cells, or at the nearest pixel past the last row and column
+    _nodes.create(cells.height + 1, cells.width + 1, CV_32SC2);
+    for (int i = 0; i <= cells.height; ++i)
     {
-        R.getMat().convertTo(RR, CV_64F);
+        for (int j = 0; j <= cells.width; ++j)
+            _nodes.at<Vec2i>(i, j) = getFixedPoint(m1, m2, std::min(i*gridStep, m1.rows - 1), std::min(j*gridStep, m1.cols - 1));
     }
 
-    const cv::Vec2d *srcd = distorted.getMat().ptr<cv::Vec2d>();
-    const cv::Vec2f *srcf = distorted.getMat().ptr<cv::Vec2f>();
+    _deltas.create(m1.size(), CV_8SC2);
+    _cells.create(cells, CV_32S);
+    _cells.setTo(Scalar::all(0));
+    CompactEncodeInvoker invoker(m1, m2, _nodes, _shift, _deltas, _cells);
+    parallel_for_(Range(0, cells.height), invoker, m1.total() / (double)(1 << 16));
 
-    cv::Vec2d *dstd = undistorted.getMat().ptr<cv::Vec2d>();
-    cv::Vec2f *dstf = undistorted.getMat().ptr<cv::Vec2f>();
+    // the exact coordinates of the cells that overflowed, which are few
+    int count = countNonZero(_cells);
+    _exact.release();
+    if (count != 0)
+        _exact.create(1, count * gridStep * gridStep, CV_32SC2);
 
-    int n = (int)distorted.total();
-    for (int i = 0; i < n; i++)
+    int offset = 0;
+    for (int cy = 0; cy < cells.height; ++cy)
     {
-        Vec2d pi = distorted.depth() == CV_32F ? (Vec2d)srcf[i]:(Vec2d)srcd[i];    // image point
-        Vec2d pp((pi[0]*f[1]-c[0]*f[1]-s*(pi[1]-c[1]))/(f[0]*f[1]), (pi[1]-c[1])/f[1]); //plane
-        Vec2d pu = pp;    // points without distortion
-
-        // remove distortion iteratively
-        for (int j = 0; j < 20; j++)
+        int* cell = _cells.ptr<int>(cy);
+        for (int cx = 0; cx < cells.width; ++cx)
         {
-            double r2 = pu[0]*pu[0] + pu[1]*pu[1];
-            double r4 = r2*r2;
-            pu[0] = (pp[0] - 2*p[0]*pu[0]*pu[1] - p[1]*(r2+2*pu[0]*pu[0])) / (1 + k[0]*r2 + k[1]*r4);
-            pu[1] = (pp[1] - 2*p[1]*pu[0]*pu[1] - p[0]*(r2+2*pu[1]*pu[1])) / (1 + k[0]*r2 + k[1]*r4);
+            if (cell[cx] == 0)
+            {
+                cell[cx] = -1;
+                continue;
+            }
+
+            cell[cx] = offset;
+            Vec2i* exact = _exact.ptr<Vec2i>() + offset;
+            for (int fy = 0; fy < gridStep; ++fy)
+            {
+                for (int fx = 0; fx < gridStep; ++fx)
+                {
+                    int y = std::min(cy*gridStep + fy, m1.rows - 1), x = std::min(cx*gridStep + fx, m1.cols - 1);
+                    exact[fy*gridStep + fx] = getFixedPoint(m1, m2, y, x);
+                }
+            }
+            offset += gridStep * gridStep;
         }
+    }
+}
 
-        // project to unit sphere
-        double r2 = pu[0]*pu[0] + pu[1]*pu[1];
-        double a = (r2 + 1);
-        double b = 2*_xi*r2;
-        double cc = r2*_xi*_xi-1;
-        double Zs = (-b + sqrt(b*b - 4*a*cc))/(2*a);
-        Vec3d Xw = Vec3d(pu[0]*(Zs + _xi), pu[1]*(Zs +_xi), Zs);
+void cv::omnidir::CompactMap::remap(InputArray src, OutputArray dst, int interpolation, int borderMode,
+    const Scalar& borderValue) const
+{
+    CV_Assert(!empty());
 
-        // rotate
-        Xw = RR * Xw;
+    Mat _src = src.getMat();
+    dst.create(size(), _src.type());
+    Mat _dst = dst.getMat();
+    CV_Assert(_src.data != _dst.data);
 
-        // project back to sphere
-        Vec3d Xs = Xw / cv::norm(Xw);
+    int tiles = ((_dst.cols + FUSED_TILE_WIDTH - 1) / FUSED_TILE_WIDTH)
+        * ((_dst.rows + FUSED_TILE_HEIGHT - 1) / FUSED_TILE_HEIGHT);
+    CompactRemapInvoker invoker(*this, _src, _dst, interpolation, borderMode, borderValue);
+    parallel_for_(Range(0, tiles), invoker);
+}
 
-        // reproject to camera plane
-        Vec3d ppu = Vec3d(Xs[0]/(Xs[2]+_xi), Xs[1]/(Xs[2]+_xi), 1.0);
-        if (undistorted.depth() == CV_32F)
-        {
-            dstf[i] = Vec2f((float)ppu[0], (float)ppu[1]);
-        }
-        else if (undistorted.depth() == CV_64F)
-        {
-            dstd[i] = Vec2d(ppu[0], ppu[1]);
-        }
-    }
+void cv::omnidir::CompactMap::decode(OutputArray map1, OutputArray map2) const
+{
+    CV_Assert(!empty());
+
+    map1.create(size(), CV_16SC2);
+    map2.create(size(), CV_16UC1);
+    Mat _map1 = map1.getMat(), _map2 = map2.getMat();
+    for (int i = 0; i < _map1.rows; ++i)
+        decodeCompactRow(*this, i, 0, _map1.cols, _map1.ptr<short>(i), _map2.ptr<ushort>(i));
+}
+
+size_t cv::omnidir::CompactMap::memorySize() const
+{
+    return _nodes.total()*_nodes.elemSize() + _deltas.total()*_deltas.elemSize() + _cells.total()*_cells.elemSize()
+        + _exact.total()*_exact.elemSize();
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// rectification map files
 
-/////////////////////////////////////////////////////////////////////////////
-//////// cv::omnidir::initUndistortRectifyMap
-void cv::omnidir::initUndistortRectifyMap(InputArray K, InputArray D, InputArray xi, InputArray R, InputArray P,
-    const cv::Size& size, int m1type, OutputArray map1, OutputArray map2, int flags)
+namespace cv { namespace
 {
-    CV_Assert( m1type == CV_16SC2 || m1type == CV_32F || m1type <=0 );
-    map1.create( size, m1type <= 0 ? CV_16SC2 : m1type );
-    map2.create( size, map1.type() == CV_16SC2 ? CV_16UC1 : CV_32F );
+    // Layout of a map file: this header, then map1 and map2 row after row, each at a multiple of 64 bytes.
+    // The numbers are in the byte order of the host. Any change of the layout bumps the version.
+    const char RECTIFY_MAP_MAGIC[8] = {'O', 'M', 'N', 'I', 'M', 'A', 'P', 'S'};
+    const int RECTIFY_MAP_VERSION = 1;
+    const int RECTIFY_MAP_KEY_SIZE = 32;
 
-    CV_Assert((K.depth() == CV_32F || K.depth() == CV_64F) && (D.depth() == CV_32F || D.depth() == CV_64F));
-    CV_Assert(K.size() == Size(3, 3) && (D.empty() || D.total() == 4));
-    CV_Assert(P.empty()|| (P.depth() == CV_32F || P.depth() == CV_64F));
-    CV_Assert(P.empty() || P.size() == Size(3, 3) || P.size() == Size(4, 3));
-    CV_Assert(R.empty() || (R.depth() == CV_32F || R.depth() == CV_64F));
-    CV_Assert(R.empty() || R.size() == Size(3, 3) || R.total() * R.channels() == 3);
-    CV_Assert(flags == RECTIFY_PERSPECTIVE || flags == RECTIFY_CYLINDRICAL || flags == RECTIFY_LONGLATI
-        || flags == RECTIFY_STEREOGRAPHIC);
-    CV_Assert(xi.total() == 1 && (xi.depth() == CV_32F || xi.depth() == CV_64F));
-
-    cv::Vec2d f, c;
-    double s;
-    if (K.depth() == CV_32F)
-    {
-        Matx33f camMat = K.getMat();
-        f = Vec2f(camMat(0, 0), camMat(1, 1));
-        c = Vec2f(camMat(0, 2), camMat(1, 2));
-        s = (double)camMat(0,1);
-    }
-    else
+    struct RectifyMapFileHeader
     {
-        Matx33d camMat = K.getMat();
-        f = Vec2d(camMat(0, 0), camMat(1, 1));
-        c = Vec2d(camMat(0, 2), camMat(1, 2));
-        s = camMat(0,1);
-    }
+        char magic[8];
+        int version;
+        int m1type, m2type, flags;
+        int width, height;
+        uint64 hash;
+        double key[RECTIFY_MAP_KEY_SIZE];    // K, P, R, D and xi
+        uint64 offset1, offset2;
+    };
 
-    Vec4d kp = Vec4d::all(0);
-    if (!D.empty())
-        kp = D.depth() == CV_32F ? (Vec4d)*D.getMat().ptr<Vec4f>(): *D.getMat().ptr<Vec4d>();
-    double _xi = xi.depth() == CV_32F ? (double)*xi.getMat().ptr<float>() : *xi.getMat().ptr<double>();
-    Vec2d k = Vec2d(kp[0], kp[1]);
-    Vec2d p = Vec2d(kp[2], kp[3]);
-    cv::Matx33d RR  = cv::Matx33d::eye();
-    if (!R.empty() && R.total() * R.channels() == 3)
+    inline size_t alignMapOffset(size_t offset)
     {
-        cv::Vec3d rvec;
-        R.getMat().convertTo(rvec, CV_64F);
-        cv::Rodrigues(rvec, RR);
+        return (offset + 63) & ~(size_t)63;
     }
-    else if (!R.empty() && R.size() == Size(3, 3))
-        R.getMat().convertTo(RR, CV_64F);
-
-    cv::Matx33d PP = cv::Matx33d::eye();
-    if (!P.empty())
-        P.getMat().colRange(0, 3).convertTo(PP, CV_64F);
-    else
-        PP = K.getMat();
 
-    cv::Matx33d iKR = (PP*RR).inv(cv::DECOMP_SVD);
-    cv::Matx33d iK = PP.inv(cv::DECOMP_SVD);
-    cv::Matx33d iR = RR.inv(cv::DECOMP_SVD);
+    // Header of the maps of the given parameters, without the offsets
+    void getRectifyMapHeader(InputArray K, InputArray D, InputArray xi, InputArray R, InputArray P, const Size& size,
+        int m1type, int flags, RectifyMapFileHeader& header)
+    {
+        CV_Assert(m1type == CV_16SC2 || m1type == CV_32F);
+        CV_Assert(size.width > 0 && size.height > 0);
+
+        UndistorterKey key;
+        getUndistorterKey(K, D, xi, flags, P, size, R, key);
+
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, RECTIFY_MAP_MAGIC, sizeof(header.magic));
+        header.version = RECTIFY_MAP_VERSION;
+        header.m1type = m1type;
+        header.m2type = m1type == CV_16SC2 ? CV_16UC1 : CV_32F;
+        header.flags = flags;
+        header.width = size.width;
+        header.height = size.height;
+
+        double* k = header.key;
+        std::copy(key.K.val, key.K.val + 9, k);
+        std::copy(key.Knew.val, key.Knew.val + 9, k + 9);
+        std::copy(key.R.val, key.R.val + 9, k + 18);
+        std::copy(key.D.val, key.D.val + 4, k + 27);
+        k[31] = key.xi;
+
+        // 64 bit FNV-1a of everything above
+        uint64 hash = CV_BIG_UINT(14695981039346656037);
+        const uchar* bytes = (const uchar*)&header;
+        for (size_t i = 0; i < sizeof(header); ++i)
+            hash = (hash ^ bytes[i]) * CV_BIG_UINT(1099511628211);
+        header.hash = hash;
+    }
 
-    if (flags == omnidir::RECTIFY_PERSPECTIVE)
+#ifndef _WIN32
+    // Owner of a private mapping of a map file, unmapped with the last Mat that uses it
+    class FileMappingAllocator : public MatAllocator
     {
-        for (int i = 0; i < size.height; ++i)
+    public:
+        UMatData* allocate(int, const int*, int, void*, size_t*, int, UMatUsageFlags) const
         {
-            float* m1f = map1.getMat().ptr<float>(i);
-            float* m2f = map2.getMat().ptr<float>(i);
-            short*  m1 = (short*)m1f;
-            ushort* m2 = (ushort*)m2f;
+            return NULL;
+        }
 
-            double _x = i*iKR(0, 1) + iKR(0, 2),
-                   _y = i*iKR(1, 1) + iKR(1, 2),
-                   _w = i*iKR(2, 1) + iKR(2, 2);
-            for(int j = 0; j < size.width; ++j, _x+=iKR(0,0), _y+=iKR(1,0), _w+=iKR(2,0))
-            {
-                // project back to unit sphere
-                double r = sqrt(_x*_x + _y*_y + _w*_w);
-                double Xs = _x / r;
-                double Ys = _y / r;
-                double Zs = _w / r;
-                // project to image plane
-                double xu = Xs / (Zs + _xi),
-                    yu = Ys / (Zs + _xi);
-                // add distortion
-                double r2 = xu*xu + yu*yu;
-                double r4 = r2*r2;
-                double xd = (1+k[0]*r2+k[1]*r4)*xu + 2*p[0]*xu*yu + p[1]*(r2+2*xu*xu);
-                double yd = (1+k[0]*r2+k[1]*r4)*yu + p[0]*(r2+2*yu*yu) + 2*p[1]*xu*yu;
-                // to image pixel
-                double u = f[0]*xd + s*yd + c[0];
-                double v = f[1]*yd + c[1];
-
-                if( m1type == CV_16SC2 )
-                {
-                    int iu = cv::saturate_cast<int>(u*cv::INTER_TAB_SIZE);
-                    int iv = cv::saturate_cast<int>(v*cv::INTER_TAB_SIZE);
-                    m1[j*2+0] = (short)(iu >> cv::INTER_BITS);
-                    m1[j*2+1] = (short)(iv >> cv::INTER_BITS);
-                    m2[j] = (ushort)((iv & (cv::INTER_TAB_SIZE-1))*cv::INTER_TAB_SIZE + (iu & (cv::INTER_TAB_SIZE-1)));
-                }
-                else if( m1type == CV_32FC1 )
-                {
-                    m1f[j] = (float)u;
-                    m2f[j] = (float)v;
-                }
-            }
+        bool allocate(UMatData*, int, UMatUsageFlags) const
+        {
+            return false;
         }
-    }
-    else if(flags == omnidir::RECTIFY_CYLINDRICAL || flags == omnidir::RECTIFY_LONGLATI ||
-        flags == omnidir::RECTIFY_STEREOGRAPHIC)
-    {
-        for (int i = 0; i < size.height; ++i)
+
+        void deallocate(UMatData* u) const
         {
-            float* m1f = map1.getMat().ptr<float>(i);
-            float* m2f = map2.getMat().ptr<float>(i);
-            short*  m1 = (short*)m1f;
-            ushort* m2 = (ushort*)m2f;
+            if (!u)
+                return;
+            munmap(u->origdata, u->size);
+            delete u;
+        }
+    };
 
-            // for RECTIFY_LONGLATI, theta and h are longittude and latitude
-            double theta = i*iK(0, 1) + iK(0, 2),
-                   h     = i*iK(1, 1) + iK(1, 2);
+    FileMappingAllocator fileMappingAllocator;
+#endif
 
-            for (int j = 0; j < size.width; ++j, theta+=iK(0,0), h+=iK(1,0))
-            {
-                double _xt = 0.0, _yt = 0.0, _wt = 0.0;
-                if (flags == omnidir::RECTIFY_CYLINDRICAL)
-                {
-                    //_xt = std::sin(theta);
-                    //_yt = h;
-                    //_wt = std::cos(theta);
-                    _xt = std::cos(theta);
-                    _yt = std::sin(theta);
-                    _wt = h;
-                }
-                else if (flags == omnidir::RECTIFY_LONGLATI)
-                {
-                    _xt = -std::cos(theta);
-                    _yt = -std::sin(theta) * std::cos(h);
-                    _wt = std::sin(theta) * std::sin(h);
-                }
-                else if (flags == omnidir::RECTIFY_STEREOGRAPHIC)
-                {
-                    double a = theta*theta + h*h + 4;
-                    double b = -2*theta*theta - 2*h*h;
-                    double c2 = theta*theta + h*h -4;
+    // Mat of the given type over the bytes of the mapping u at offset, sharing its ownership
+    Mat fileMapView(UMatData* u, size_t offset, const Size& size, int type)
+    {
+        Mat m(size, type, u->data + offset);
+        m.u = u;
+        CV_XADD(&m.u->refcount, 1);
+        return m;
+    }
 
-                    _yt = (-b-std::sqrt(b*b - 4*a*c2))/(2*a);
-                    _xt = theta*(1 - _yt) / 2;
-                    _wt = h*(1 - _yt) / 2;
-                }
-                double _x = iR(0,0)*_xt + iR(0,1)*_yt + iR(0,2)*_wt;
-                double _y = iR(1,0)*_xt + iR(1,1)*_yt + iR(1,2)*_wt;
-                double _w = iR(2,0)*_xt + iR(2,1)*_yt + iR(2,2)*_wt;
-
-                double r = sqrt(_x*_x + _y*_y + _w*_w);
-                double Xs = _x / r;
-                double Ys = _y / r;
-                double Zs = _w / r;
-                // project to image plane
-                double xu = Xs / (Zs + _xi),
-                       yu = Ys / (Zs + _xi);
-                // add distortion
-                double r2 = xu*xu + yu*yu;
-                double r4 = r2*r2;
-                double xd = (1+k[0]*r2+k[1]*r4)*xu + 2*p[0]*xu*yu + p[1]*(r2+2*xu*xu);
-                double yd = (1+k[0]*r2+k[1]*r4)*yu + p[0]*(r2+2*yu*yu) + 2*p[1]*xu*yu;
-                // to image pixel
-                double u = f[0]*xd + s*yd + c[0];
-                double v = f[1]*yd + c[1];
-
-                if( m1type == CV_16SC2 )
-                {
-                    int iu = cv::saturate_cast<int>(u*cv::INTER_TAB_SIZE);
-                    int iv = cv::saturate_cast<int>(v*cv::INTER_TAB_SIZE);
-                    m1[j*2+0] = (short)(iu >> cv::INTER_BITS);
-                    m1[j*2+1] = (short)(iv >> cv::INTER_BITS);
-                    m2[j] = (ushort)((iv & (cv::INTER_TAB_SIZE-1))*cv::INTER_TAB_SIZE + (iu & (cv::INTER_TAB_SIZE-1)));
-                }
-                else if( m1type == CV_32FC1 )
-                {
-                    m1f[j] = (float)u;
-                    m2f[j] = (float)v;
-                }
-            }
-        }
+    // Name of a temporary file next to filename that no other thread or process of the host uses
+    String tempFileName(const String& filename)
+    {
+        static int counter = 0;
+#ifndef _WIN32
+        int pid = (int)getpid();
+#else
+        int pid = _getpid();
+#endif
+        return filename + format(".%d.%d.tmp", pid, CV_XADD(&counter, 1));
+    }
+
+    // Renames the file from to the name to, replacing any file of that name, which std::rename does not on Windows
+    bool replaceFile(const String& from, const String& to)
+    {
+#ifndef _WIN32
+        return std::rename(from.c_str(), to.c_str()) == 0;
+#else
+        return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#endif
     }
+
+    Mutex rectifyMapCacheMutex;
+    String rectifyMapCacheDir;
+}}
+
+void cv::omnidir::setRectifyMapCacheDir(const String& dir)
+{
+    AutoLock lock(rectifyMapCacheMutex);
+    rectifyMapCacheDir = dir;
 }
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////
-/// cv::omnidir::undistortImage
+cv::String cv::omnidir::rectifyMapCacheFile(InputArray K, InputArray D, InputArray xi, InputArray R, InputArray P,
+    const Size& size, int m1type, int flags)
+{
+    String dir;
+    {
+        AutoLock lock(rectifyMapCacheMutex);
+        dir = rectifyMapCacheDir;
+    }
+    if (dir.empty())
+        return String();
 
-void cv::omnidir::undistortImage(InputArray distorted, OutputArray undistorted,
-    InputArray K, InputArray D, InputArray xi, int flags, InputArray Knew, const Size& new_size, InputArray R)
+    RectifyMapFileHeader header;
+    getRectifyMapHeader(K, D, xi, R, P, size, m1type <= 0 ? CV_16SC2 : m1type, flags, header);
+    return dir + "/omnidir_" + format("%016llx", (unsigned long long)header.hash) + ".maps";
+}
+
+bool cv::omnidir::saveRectifyMaps(const String& filename, InputArray K, InputArray D, InputArray xi, InputArray R,
+    InputArray P, const Size& size, InputArray map1, InputArray map2, int flags)
 {
-    Size size = new_size.area() != 0 ? new_size : distorted.size();
+    RectifyMapFileHeader header;
+    getRectifyMapHeader(K, D, xi, R, P, size, map1.type(), flags, header);
+
+    Mat m1 = map1.getMat(), m2 = map2.getMat();
+    CV_Assert(m1.size() == size && m2.size() == size && m2.type() == header.m2type);
+
+    size_t rowSize1 = size.width*m1.elemSize(), rowSize2 = size.width*m2.elemSize();
+    header.offset1 = alignMapOffset(sizeof(header));
+    header.offset2 = alignMapOffset(header.offset1 + rowSize1*size.height);
+
+    // written next to the file and renamed over it, so that readers never see a partial file
+    String tmpname = tempFileName(filename);
+    std::ofstream out(tmpname.c_str(), std::ios::binary);
+    if (!out)
+        return false;
+
+    std::vector<char> padding(64, 0);
+    out.write((const char*)&header, sizeof(header));
+    out.write(&padding[0], header.offset1 - sizeof(header));
+    for (int i = 0; i < size.height; ++i)
+        out.write((const char*)m1.ptr(i), rowSize1);
+    out.write(&padding[0], header.offset2 - (header.offset1 + rowSize1*size.height));
+    for (int i = 0; i < size.height; ++i)
+        out.write((const char*)m2.ptr(i), rowSize2);
+    out.close();
+
+    if (!out || !replaceFile(tmpname, filename))
+    {
+        std::remove(tmpname.c_str());
+        return false;
+    }
+    return true;
+}
 
-    cv::Mat map1, map2;
-    omnidir::initUndistortRectifyMap(K, D, xi, R, Knew, size, CV_16SC2, map1, map2, flags);
-    cv::remap(distorted, undistorted, map1, map2, INTER_LINEAR, BORDER_CONSTANT);
+bool cv::omnidir::loadRectifyMaps(const String& filename, InputArray K, InputArray D, InputArray xi, InputArray R,
+    InputArray P, const Size& size, int m1type, OutputArray map1, OutputArray map2, int flags)
+{
+    RectifyMapFileHeader expected;
+    getRectifyMapHeader(K, D, xi, R, P, size, m1type <= 0 ? CV_16SC2 : m1type, flags, expected);
+
+    size_t rowSize1 = size.width*CV_ELEM_SIZE(expected.m1type), rowSize2 = size.width*CV_ELEM_SIZE(expected.m2type);
+
+    // the file size is kept in 64 bits, full sphere maps may be larger than an int can count
+#ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    void* base = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (uint64)st.st_size >= sizeof(RectifyMapFileHeader)
+        && (uint64)st.st_size <= (uint64)(size_t)-1)
+        base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return false;
+
+    // the maps point into the mapping, which lives as long as they do. Until they take it, owner holds it.
+    UMatData* u = new UMatData(&fileMappingAllocator);
+    u->data = u->origdata = (uchar*)base;
+    u->size = (size_t)st.st_size;
+    u->refcount = 1;
+    Mat owner(1, (int)sizeof(RectifyMapFileHeader), CV_8U, u->data);
+    owner.u = u;
+
+    const RectifyMapFileHeader& header = *(const RectifyMapFileHeader*)base;
+    uint64 fileSize = (uint64)st.st_size;
+#else
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    if (!in)
+        return false;
+    RectifyMapFileHeader header;
+    in.read((char*)&header, sizeof(header));
+    in.seekg(0, std::ios::end);
+    if (!in)
+        return false;
+    uint64 fileSize = (uint64)(std::streamoff)in.tellg();
+#endif
+
+    if (memcmp(&header, &expected, offsetof(RectifyMapFileHeader, offset1)) != 0
+        || header.offset1 < sizeof(header) || header.offset1 > fileSize
+        || (uint64)rowSize1*size.height > fileSize - header.offset1
+        || header.offset2 < sizeof(header) || header.offset2 > fileSize
+        || (uint64)rowSize2*size.height > fileSize - header.offset2)
+        return false;
+
+#ifndef _WIN32
+    Mat m1 = fileMapView(u, (size_t)header.offset1, size, expected.m1type);
+    Mat m2 = fileMapView(u, (size_t)header.offset2, size, expected.m2type);
+#else
+    // the maps are read straight into their own buffers
+    Mat m1(size, expected.m1type), m2(size, expected.m2type);
+    in.seekg((std::streamoff)header.offset1, std::ios::beg);
+    in.read((char*)m1.data, rowSize1*size.height);
+    in.seekg((std::streamoff)header.offset2, std::ios::beg);
+    in.read((char*)m2.data, rowSize2*size.height);
+    if (!in)
+        return false;
+#endif
+
+    // a Mat output takes the views, anything else a copy
+    if (map1.kind() == _InputArray::MAT)
+        map1.getMatRef() = m1;
+    else
+        m1.copyTo(map1);
+    if (map2.kind() == _InputArray::MAT)
+        map2.getMatRef() = m2;
+    else
+        m2.copyTo(map2);
+    return true;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -699,10 +4097,14 @@ void cv::omnidir::internal::initializeCalibration(InputArrayOfArrays patternPoin
     _K.convertTo(K, CV_64F);
     std::vector<int> _idx;
     // recompute reproject error using the final gamma
+    Mat projectedAll;
+    cv::omnidir::projectPointsBatch(patternPoints, projectedAll, v_omAll, v_tAll, _K, 1, Matx14d(0, 0, 0, 0));
+    int nPointsAccu = 0;
     for (int i = 0; i< n_img; i++)
     {
-        Mat _projected;
-        cv::omnidir::projectPoints(patternPoints.getMat(i), _projected, v_omAll[i], v_tAll[i], _K, 1, Matx14d(0, 0, 0, 0), cv::noArray());
+        int nPoints = (int)patternPoints.getMat(i).total();
+        Mat _projected = projectedAll.colRange(nPointsAccu, nPointsAccu + nPoints);
+        nPointsAccu += nPoints;
         double _error = omnidir::internal::computeMeanReproErr(imagePoints.getMat(i), _projected);
         if(_error < 100)
         {
@@ -854,61 +4256,48 @@ void cv::omnidir::internal::computeJacobian(InputArrayOfArrays objectPoints, Inp
     JTJ_inv = Mat::zeros(10 + 6*n, 10 + 6*n, CV_64F);
     JTE = Mat::zeros(10 + 6*n, 1, CV_64F);
 
-    int nPointsAll = 0;
-    for (int i = 0; i < n; ++i)
-    {
-        nPointsAll += (int)objectPoints.getMat(i).total();
-    }
-
-    Mat J = Mat::zeros(2*nPointsAll, 10+6*n, CV_64F);
-    Mat exAll = Mat::zeros(2*nPointsAll, 10+6*n, CV_64F);
     double *para = parameters.getMat().ptr<double>();
-    Matx33d K(para[6*n], para[6*n+2], para[6*n+3],
-        0,    para[6*n+1], para[6*n+4],
-        0,    0,  1);
-    Matx14d D(para[6*n+6], para[6*n+7], para[6*n+8], para[6*n+9]);
-    double xi = para[6*n+5];
+    ProjectionParams p;
+    p.f = Vec2d(para[6*n], para[6*n+1]);
+    p.s = para[6*n+2];
+    p.c = Vec2d(para[6*n+3], para[6*n+4]);
+    p.xi = para[6*n+5];
+    p.kp = Vec4d(para[6*n+6], para[6*n+7], para[6*n+8], para[6*n+9]);
+    int live = flags2jacobian(flags);
+
     for (int i = 0; i < n; i++)
     {
-        Mat objPoints, imgPoints, om, T;
+        Mat objPoints, imgPoints;
 		objectPoints.getMat(i).copyTo(objPoints);
 		imagePoints.getMat(i).copyTo(imgPoints);
 		objPoints = objPoints.reshape(3, objPoints.rows*objPoints.cols);
 		imgPoints = imgPoints.reshape(2, imgPoints.rows*imgPoints.cols);
 
-        om = parameters.getMat().colRange(i*6, i*6+3);
-        T = parameters.getMat().colRange(i*6+3, (i+1)*6);
-        Mat imgProj, jacobian;
-        omnidir::projectPoints(objPoints, imgProj, om, T, K, xi, D, jacobian);
-        Mat projError = imgPoints - imgProj;
-
-        // The intrinsic part of Jacobian
-        Mat JIn(jacobian.rows, 10, CV_64F);
-        Mat JEx(jacobian.rows, 6, CV_64F);
+        Rodrigues(Vec3d(para + i*6), p.R, p.dRdom);
+        p.T = Vec3d(para + i*6 + 3);
 
-        jacobian.colRange(6, 16).copyTo(JIn);
-        jacobian.colRange(0, 6).copyTo(JEx);
-
-        JTJ(Rect(6*n, 6*n, 10, 10)) = JTJ(Rect(6*n, 6*n, 10, 10)) + JIn.t()*JIn;
-
-        JTJ(Rect(i*6, i*6, 6, 6)) = JEx.t() * JEx;
+        // the per-point jacobian rows are folded into the normal equations as they are computed,
+        // columns 0-5 are the extrinsic and columns 6-15 the intrinsic part
+        Matx<double, 16, 16> JtJ;
+        Vec<double, 16> JtE;
+        if (flags & CALIB_MIXED_PRECISION)
+            accumulateNormalEquationsF32(p, objPoints.ptr<Vec3d>(), imgPoints.ptr<Vec2d>(), (int)objPoints.total(), live, JtJ, JtE);
+        else
+            accumulateNormalEquations(p, objPoints.ptr<Vec3d>(), imgPoints.ptr<Vec2d>(), (int)objPoints.total(), live, JtJ, JtE);
+        Mat _JtJ(16, 16, CV_64F, JtJ.val), _JtE(16, 1, CV_64F, JtE.val);
 
-        Mat JExTIn = JEx.t() * JIn;
+        JTJ(Rect(6*n, 6*n, 10, 10)) = JTJ(Rect(6*n, 6*n, 10, 10)) + _JtJ(Rect(6, 6, 10, 10));
 
-        JExTIn.copyTo(JTJ(Rect(6*n, i*6, 10, 6)));
+        _JtJ(Rect(0, 0, 6, 6)).copyTo(JTJ(Rect(i*6, i*6, 6, 6)));
 
-        Mat(JIn.t()*JEx).copyTo(JTJ(Rect(i*6, 6*n, 6, 10)));
+        _JtJ(Rect(6, 0, 10, 6)).copyTo(JTJ(Rect(6*n, i*6, 10, 6)));
 
-        JTE(Rect(0, 6*n, 1, 10)) = JTE(Rect(0, 6*n,1, 10)) + JIn.t() * projError.reshape(1, 2*(int)projError.total());
-        JTE(Rect(0, i*6, 1, 6)) = JEx.t() * projError.reshape(1, 2*(int)projError.total());
+        _JtJ(Rect(0, 6, 6, 10)).copyTo(JTJ(Rect(i*6, 6*n, 6, 10)));
 
-        //int nPoints = objectPoints.getMat(i).total();
-        //JIn.copyTo(J(Rect(6*n, i*nPoints*2, 10, nPoints*2)));
-        //JEx.copyTo(J(Rect(6*i, i*nPoints*2, 6, nPoints*2)));
-        //projError.reshape(1, 2*projError.rows).copyTo(exAll.rowRange(i*2*nPoints, (i+1)*2*nPoints));
+        JTE(Rect(0, 6*n, 1, 10)) = JTE(Rect(0, 6*n,1, 10)) + _JtE.rowRange(6, 16);
+        _JtE.rowRange(0, 6).copyTo(JTE(Rect(0, i*6, 1, 6)));
     }
-    //JTJ = J.t()*J;
-    //JTE = J.t()*exAll;
+
     std::vector<int> _idx(6*n+10, 1);
     flags2idx(flags, _idx, n);
 
@@ -976,7 +4365,7 @@ void cv::omnidir::internal::computeJacobianStereo(InputArrayOfArrays objectPoint
         Mat imgProj1, imgProj2, jacobian1, jacobian2;
 
         // jacobian for left image
-        cv::omnidir::projectPoints(objPointsi, imgProj1, om1, T1, K1, xi1, D1, jacobian1);
+        cv::omnidir::internal::projectPoints(objPointsi, imgProj1, om1, T1, K1, xi1, D1, jacobian1, flags);
         Mat projError1 = imgPoints1i - imgProj1;
         //Mat JIn1(jacobian1.rows, 10, CV_64F);
         //Mat JEx1(jacobian1.rows, 6, CV_64F);
@@ -987,7 +4376,7 @@ void cv::omnidir::internal::computeJacobianStereo(InputArrayOfArrays objectPoint
         //jacobian for right image
         Mat om2, T2, dom2dom1, dom2dT1, dom2dom, dom2dT, dT2dom1, dT2dT1, dT2dom, dT2dT;
         cv::omnidir::internal::compose_motion(om1, T1, om, T, om2, T2, dom2dom1, dom2dT1, dom2dom, dom2dT, dT2dom1, dT2dT1, dT2dom, dT2dT);
-        cv::omnidir::projectPoints(objPointsi, imgProj2, om2, T2, K2, xi2, D2, jacobian2);
+        cv::omnidir::internal::projectPoints(objPointsi, imgProj2, om2, T2, K2, xi2, D2, jacobian2, flags);
         Mat projError2 = imgPoints2i - imgProj2;
         projError2.reshape(1, 2*n_points).copyTo(exAll.rowRange((i*4+2)*n_points, (i*4+4)*n_points));
         Mat dxrdom = jacobian2.colRange(0, 3) * dom2dom + jacobian2.colRange(3, 6) * dT2dom;
@@ -1061,6 +4450,15 @@ void cv::omnidir::internal::compose_motion(InputArray _om1, InputArray _T1, Inpu
 double cv::omnidir::calibrate(InputArrayOfArrays patternPoints, InputArrayOfArrays imagePoints, Size size,
     InputOutputArray K, InputOutputArray xi, InputOutputArray D, OutputArrayOfArrays omAll, OutputArrayOfArrays tAll,
     int flags, TermCriteria criteria, OutputArray idx)
+{
+    double mixedPrecisionStep;
+    return omnidir::calibrate(patternPoints, imagePoints, size, K, xi, D, omAll, tAll, flags, criteria, idx,
+        mixedPrecisionStep);
+}
+
+double cv::omnidir::calibrate(InputArrayOfArrays patternPoints, InputArrayOfArrays imagePoints, Size size,
+    InputOutputArray K, InputOutputArray xi, InputOutputArray D, OutputArrayOfArrays omAll, OutputArrayOfArrays tAll,
+    int flags, TermCriteria criteria, OutputArray idx, double& mixedPrecisionStep)
 {
     CV_Assert(!patternPoints.empty() && !imagePoints.empty() && patternPoints.total() == imagePoints.total());
     CV_Assert((patternPoints.type() == CV_64FC3 && imagePoints.type() == CV_64FC2) ||
@@ -1141,6 +4539,18 @@ double cv::omnidir::calibrate(InputArrayOfArrays patternPoints, InputArrayOfArra
     }
     cv::omnidir::internal::decodeParameters(currentParam, _K, _omAll, _tAll, _D, _xi);
 
+    // the step a double precision iteration would still take from the mixed precision solution
+    mixedPrecisionStep = 0;
+    if (flags & CALIB_MIXED_PRECISION)
+    {
+        Mat JTJ_inv, JTError;
+        cv::omnidir::internal::computeJacobian(_patternPoints, _imagePoints, currentParam, JTJ_inv, JTError,
+            flags & ~CALIB_MIXED_PRECISION, 0.0);
+        Mat G = JTJ_inv * JTError;
+        omnidir::internal::fillFixed(G, flags, n);
+        mixedPrecisionStep = norm(G) / norm(currentParam);
+    }
+
     //double repr = internal::computeMeanReproErr(_patternPoints, _imagePoints, _K, _D, _xi, _omAll, _tAll);
 
     if (omAll.needed())
@@ -1204,9 +4614,28 @@ double cv::omnidir::calibrate(InputArrayOfArrays patternPoints, InputArrayOfArra
     return rms;
 }
 
+double cv::omnidir::calibrate(InputArrayOfArrays patternPoints, InputArrayOfArrays imagePoints, Size size,
+    InputOutputArray K, InputOutputArray xi, InputOutputArray D, OutputArrayOfArrays omAll, OutputArrayOfArrays tAll,
+    int flags, TermCriteria criteria, OutputArray idx, OutputArray Dinv, double& inverseError)
+{
+    double rms = omnidir::calibrate(patternPoints, imagePoints, size, K, xi, D, omAll, tAll, flags, criteria, idx);
+    inverseError = omnidir::fitInverseDistortion(K, D, xi, size, Dinv);
+    return rms;
+}
+
 double cv::omnidir::stereoCalibrate(InputOutputArrayOfArrays objectPoints, InputOutputArrayOfArrays imagePoints1, InputOutputArrayOfArrays imagePoints2,
     const Size& imageSize1, const Size& imageSize2, InputOutputArray K1, InputOutputArray xi1, InputOutputArray D1, InputOutputArray K2, InputOutputArray xi2,
     InputOutputArray D2, OutputArray om, OutputArray T, OutputArrayOfArrays omL, OutputArrayOfArrays tL, int flags, TermCriteria criteria, OutputArray idx)
+{
+    double mixedPrecisionStep;
+    return omnidir::stereoCalibrate(objectPoints, imagePoints1, imagePoints2, imageSize1, imageSize2, K1, xi1, D1, K2, xi2, D2,
+        om, T, omL, tL, flags, criteria, idx, mixedPrecisionStep);
+}
+
+double cv::omnidir::stereoCalibrate(InputOutputArrayOfArrays objectPoints, InputOutputArrayOfArrays imagePoints1, InputOutputArrayOfArrays imagePoints2,
+    const Size& imageSize1, const Size& imageSize2, InputOutputArray K1, InputOutputArray xi1, InputOutputArray D1, InputOutputArray K2, InputOutputArray xi2,
+    InputOutputArray D2, OutputArray om, OutputArray T, OutputArrayOfArrays omL, OutputArrayOfArrays tL, int flags, TermCriteria criteria, OutputArray idx,
+    double& mixedPrecisionStep)
 {
     CV_Assert(!objectPoints.empty() && (objectPoints.type() == CV_64FC3 || objectPoints.type() == CV_32FC3));
     CV_Assert(!imagePoints1.empty() && (imagePoints1.type() == CV_64FC2 || imagePoints1.type() == CV_32FC2));
@@ -1297,6 +4726,18 @@ double cv::omnidir::stereoCalibrate(InputOutputArrayOfArrays objectPoints, Input
     //double repr = internal::computeMeanReproErrStereo(_objectPoints, _imagePoints1, _imagePoints2, _K1, _K2, _D1, _D2, _xi1, _xi2, _om,
     //    _T, _omL, _TL);
 
+    // the step a double precision iteration would still take from the mixed precision solution
+    mixedPrecisionStep = 0;
+    if (flags & CALIB_MIXED_PRECISION)
+    {
+        Mat JTJ_inv, JTError;
+        cv::omnidir::internal::computeJacobianStereo(_objectPointsFilt, _imagePoints1Filt, _imagePoints2Filt, finalParam,
+            JTJ_inv, JTError, flags & ~CALIB_MIXED_PRECISION, 0.0);
+        Mat G = JTJ_inv * JTError;
+        omnidir::internal::fillFixedStereo(G, flags, n);
+        mixedPrecisionStep = norm(G) / norm(finalParam);
+    }
+
     if (K1.empty())
     {
         K1.create(3, 3, CV_64F);
@@ -1374,6 +4815,18 @@ double cv::omnidir::stereoCalibrate(InputOutputArrayOfArrays objectPoints, Input
     return rms;
 }
 
+double cv::omnidir::stereoCalibrate(InputOutputArrayOfArrays objectPoints, InputOutputArrayOfArrays imagePoints1, InputOutputArrayOfArrays imagePoints2,
+    const Size& imageSize1, const Size& imageSize2, InputOutputArray K1, InputOutputArray xi1, InputOutputArray D1, InputOutputArray K2, InputOutputArray xi2,
+    InputOutputArray D2, OutputArray om, OutputArray T, OutputArrayOfArrays omL, OutputArrayOfArrays tL, int flags, TermCriteria criteria, OutputArray idx,
+    OutputArray Dinv1, OutputArray Dinv2, double& inverseError1, double& inverseError2)
+{
+    double rms = omnidir::stereoCalibrate(objectPoints, imagePoints1, imagePoints2, imageSize1, imageSize2, K1, xi1, D1, K2, xi2, D2,
+        om, T, omL, tL, flags, criteria, idx);
+    inverseError1 = omnidir::fitInverseDistortion(K1, D1, xi1, imageSize1, Dinv1);
+    inverseError2 = omnidir::fitInverseDistortion(K2, D2, xi2, imageSize2, Dinv2);
+    return rms;
+}
+
 void cv::omnidir::stereoReconstruct(InputArray image1, InputArray image2, InputArray K1, InputArray D1,
     InputArray xi1, InputArray K2, InputArray D2, InputArray xi2, InputArray R, InputArray T, int flag,
     int numDisparities, int SADWindowSize, OutputArray disparity, OutputArray image1Rec, OutputArray image2Rec,
@@ -1416,7 +4869,12 @@ void cv::omnidir::stereoReconstruct(InputArray image1, InputArray image2, InputA
         Knew.getMat().convertTo(_Knew, CV_64F);
     }
 
-    undistortImage(image1.getMat(), undis1, _K1, _D1, xi1, flag, _Knew, newSize, R1);
+    // the maps of the first image also give the pixels that see it, as spans of its rows
+    Size size = newSize.area() != 0 ? newSize : image1.size();
+    Mat map1, map2, valid;
+    std::vector<Vec3i> spans;
+    initUndistortRectifyMap(_K1, _D1, xi1, R1, _Knew, size, CV_16SC2, map1, map2, flag, image1.size(), valid, spans);
+    remap(image1, undis1, map1, map2, INTER_LINEAR, BORDER_CONSTANT);
     undistortImage(image2.getMat(), undis2, _K2, _D2, xi2, flag, _Knew, newSize, R2);
 
     undis1.copyTo(image1Rec);
@@ -1432,27 +4890,23 @@ void cv::omnidir::stereoReconstruct(InputArray image1, InputArray image2, InputA
 
 	sgbm->compute(undis1, undis2, _disMap);
 
-    // some regions of image1 is black, the corresponding regions of disparity map is also invalid.
-    Mat realDis;
-	_disMap.convertTo(_disMap, CV_32F);
-    Mat(_disMap/16.0f).convertTo(realDis, CV_32F);
-
-    Mat grayImg, binaryImg, idx;
-    if (undis1.channels() == 3)
-    {
-        cvtColor(undis1, grayImg, COLOR_RGB2GRAY);
-    }
-    else
-    {
-        grayImg = undis1;
-    }
-
-    binaryImg = (grayImg <= 0);
-    findNonZero(binaryImg, idx);
-    for (int i = 0; i < (int)idx.total(); ++i)
+    // some regions of image1 is black, the corresponding regions of disparity map is also invalid. So are the
+    // regions outside the first camera, which are not in its spans and are never read.
+    Mat realDis(_disMap.size(), CV_32F, Scalar::all(0));
+    int cn = undis1.channels();
+    for (size_t k = 0; k < spans.size(); ++k)
     {
-        Vec2i _idx = idx.at<Vec2i>(i);
-        realDis.at<float>(_idx[1], _idx[0]) = 0.0f;
+        const short* dis = _disMap.ptr<short>(spans[k][0]);
+        const uchar* pixel = undis1.ptr<uchar>(spans[k][0]);
+        float* real = realDis.ptr<float>(spans[k][0]);
+        for (int x = spans[k][1]; x < spans[k][2]; ++x)
+        {
+            int c = 0;
+            while (c < cn && pixel[x*cn + c] == 0)
+                ++c;
+            if (c < cn)
+                real[x] = dis[x] / 16.0f;
+        }
     }
 
     disparity.create(realDis.size(), realDis.type());
@@ -1472,9 +4926,20 @@ void cv::omnidir::stereoReconstruct(InputArray image1, InputArray image2, InputA
 
     if (pointCloud.needed())
     {
-        for (int i = 0; i < newSize.width; ++i)
+        // the points are in column major order, each column only walked over the rows its spans cover
+        std::vector<int> firstRow(size.width, size.height), lastRow(size.width, 0);
+        for (size_t k = 0; k < spans.size(); ++k)
+        {
+            for (int x = spans[k][1]; x < spans[k][2]; ++x)
+            {
+                firstRow[x] = std::min(firstRow[x], spans[k][0]);
+                lastRow[x] = spans[k][0] + 1;
+            }
+        }
+
+        for (int i = 0; i < size.width; ++i)
         {
-            for(int j = 0; j < newSize.height; ++j)
+            for(int j = firstRow[i]; j < lastRow[i]; ++j)
             {
                 Vec3f point;
                 Vec6f pointColor;
@@ -1750,19 +5215,22 @@ void cv::omnidir::internal::estimateUncertainties(InputArrayOfArrays objectPoint
     double xi = para[6*n+5];
     int nPointsAccu = 0;
 
+    std::vector<Vec3d> omAll(n), TAll(n);
+    for (int i = 0; i < n; ++i)
+    {
+        omAll[i] = Vec3d(para + i*6);
+        TAll[i] = Vec3d(para + i*6 + 3);
+    }
+    Mat xAll;
+    omnidir::projectPointsBatch(objectPoints, xAll, omAll, TAll, K, xi, D);
+
     for(int i=0; i < n; ++i)
     {
-		Mat imgPoints, objPoints;
+		Mat imgPoints;
 		imagePoints.getMat(i).copyTo(imgPoints);
-		objectPoints.getMat(i).copyTo(objPoints);
 		imgPoints = imgPoints.reshape(2, imgPoints.rows*imgPoints.cols);
-		objPoints = objPoints.reshape(3, objPoints.rows*objPoints.cols);
-
-        Mat om = parameters.getMat().colRange(i*6, i*6+3);
-        Mat T = parameters.getMat().colRange(i*6+3, (i+1)*6);
 
-        Mat x;
-        omnidir::projectPoints(objPoints, x, om, T, K, xi, D, cv::noArray());
+        Mat x = xAll.colRange(nPointsAccu, nPointsAccu + imgPoints.rows).reshape(2, imgPoints.rows);
 
         Mat errorx = (imgPoints - x);
 
@@ -1779,8 +5247,9 @@ void cv::omnidir::internal::estimateUncertainties(InputArrayOfArrays objectPoint
     sigma_x *= sqrt(2.0*(double)reprojError.total()/(2.0*(double)reprojError.total() - 1.0));
     double s = sigma_x.at<double>(0);
 
+    // the uncertainties are always estimated in double precision
     Mat _JTJ_inv, _JTE;
-    computeJacobian(objectPoints, imagePoints, parameters, _JTJ_inv, _JTE, flags, 0.0);
+    computeJacobian(objectPoints, imagePoints, parameters, _JTJ_inv, _JTE, flags & ~CALIB_MIXED_PRECISION, 0.0);
     sqrt(_JTJ_inv, _JTJ_inv);
 
     errors = 3 * s * _JTJ_inv.diag();
@@ -1868,7 +5337,8 @@ void cv::omnidir::internal::estimateUncertaintiesStereo(InputArrayOfArrays objec
     double s = sigma_x.at<double>(0);
 
     Mat _JTJ_inv, _JTE;
-    computeJacobianStereo(objectPoints, imagePoints1, imagePoints2, _parameters, _JTJ_inv, _JTE, flags, 0.0);
+    // the uncertainties are always estimated in double precision
+    computeJacobianStereo(objectPoints, imagePoints1, imagePoints2, _parameters, _JTJ_inv, _JTE, flags & ~CALIB_MIXED_PRECISION, 0.0);
     cv::sqrt(_JTJ_inv, _JTJ_inv);
 
     errors = 3 * s * _JTJ_inv.diag();
@@ -1937,14 +5407,14 @@ double cv::omnidir::internal::computeMeanReproErr(InputArrayOfArrays objectPoint
     CV_Assert(!imagePoints.empty() && imagePoints.type() == CV_64FC2);
     std::vector<Mat> proImagePoints;
     int n = (int)objectPoints.total();
-    Mat _omAll = omAll.getMat();
-    Mat _tAll = tAll.getMat();
+    Mat proImagePointsAll;
+    cv::omnidir::projectPointsBatch(objectPoints, proImagePointsAll, omAll, tAll, K, xi, D);
+    int nPointsAccu = 0;
     for(int i = 0; i < n; ++i)
     {
-        Mat imgPoint;
-        //cv::omnidir::projectPoints(objetPoints.getMat(i), imgPoint, omAll.getMat(i), tAll.getMat(i), K.getMat(), xi, D.getMat(), noArray());
-        cv::omnidir::projectPoints(objectPoints.getMat(i), imgPoint, _omAll.at<Vec3d>(i), _tAll.at<Vec3d>(i), K.getMat(), xi, D.getMat(), noArray());
-        proImagePoints.push_back(imgPoint);
+        int nPoints = (int)objectPoints.getMat(i).total();
+        proImagePoints.push_back(proImagePointsAll.colRange(nPointsAccu, nPointsAccu + nPoints));
+        nPointsAccu += nPoints;
     }
 
     return internal::computeMeanReproErr(imagePoints, proImagePoints);
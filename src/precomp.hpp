@@ -44,6 +44,7 @@
 #define __OPENCV_PRECOMP_H__
 
 #include <opencv2/core.hpp>
+#include <opencv2/core/hal/intrin.hpp>
 #include <opencv2/calib3d.hpp>
 #include <opencv2/features2d.hpp>
 #include "opencv2/imgproc.hpp"
@@ -57,6 +57,12 @@ protected:
     }
 protected:
     std::string combine(const std::string& _item1, const std::string& _item2);
+
+    // Random CV_8UC3 image of imageSize, the same for every call
+    cv::Mat randomImage() const;
+
+    // Camera matrix of a RECTIFY_LONGLATI image of size that covers the half sphere
+    static cv::Matx33d longLatiCamera(const cv::Size& size);
 };
 TEST_F(omnidirTest, projectPoints)
 {
@@ -98,6 +104,794 @@ TEST_F(omnidirTest, projectPoints)
 
     EXPECT_LT(cv::norm(distorted0-distorted2), 1e-9);
 }
+TEST_F(omnidirTest, undistortPointsIterations)
+{
+    cv::Mat X(1, 200, CV_64FC3), distorted, undist1, undist2, iterations;
+    cv::RNG r;
+    r.fill(X, cv::RNG::UNIFORM, -5, 5);
+    cv::omnidir::projectPoints(X, distorted, this->om, this->T, this->K, this->xi, this->D);
+
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi));
+    cv::omnidir::undistortPoints(distorted, undist1, this->K, this->D, xi, cv::noArray());
+    cv::omnidir::undistortPoints(distorted, undist2, this->K, this->D, xi, cv::noArray(),
+        cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 20, 1e-12), iterations);
+
+    EXPECT_EQ(cv::norm(undist1, undist2, cv::NORM_INF), 0);
+
+    // the points in front of the camera project back to where they came from
+    cv::Matx33d R;
+    cv::Rodrigues(this->om, R);
+    std::vector<cv::Vec3d> rays;
+    std::vector<cv::Vec2d> expected;
+    for (int i = 0; i < (int)X.total(); ++i)
+    {
+        if ((R * X.at<cv::Vec3d>(i) + this->T)[2] <= 0)
+            continue;
+        cv::Vec2d u = undist2.at<cv::Vec2d>(i);
+        rays.push_back(cv::Vec3d(u[0], u[1], 1));
+        expected.push_back(distorted.at<cv::Vec2d>(i));
+    }
+    ASSERT_FALSE(rays.empty());
+    cv::Mat reprojected;
+    cv::omnidir::projectPoints(rays, reprojected, cv::Vec3d::all(0), cv::Vec3d::all(0), this->K, this->xi, this->D);
+    EXPECT_LT(cv::norm(reprojected.reshape(2, 1), cv::Mat(expected).reshape(2, 1), cv::NORM_INF), 1e-6);
+
+    ASSERT_EQ(iterations.type(), CV_32S);
+    ASSERT_EQ(iterations.total(), X.total());
+
+    double minIter, maxIter;
+    cv::minMaxLoc(iterations, &minIter, &maxIter);
+    EXPECT_GE(minIter, 1);
+    EXPECT_LT(maxIter, 20);
+
+    cv::Mat undist3;
+    cv::omnidir::undistortPoints(distorted, undist3, this->K, this->D, xi, cv::noArray(),
+        cv::TermCriteria(cv::TermCriteria::COUNT, 1, 0), iterations);
+    EXPECT_EQ(cv::countNonZero(iterations != 1), 0);
+    EXPECT_EQ(cv::countNonZero(cv::Mat(undist3 != undist3).reshape(1)), 0);
+
+    // EPS alone stops at 100 steps at most, and the points with no step under epsilon are NaN
+    cv::omnidir::undistortPoints(distorted, undist3, this->K, this->D, xi, cv::noArray(),
+        cv::TermCriteria(cv::TermCriteria::EPS, 0, 1e-12));
+    EXPECT_EQ(cv::norm(undist2, undist3, cv::NORM_INF), 0);
+    cv::omnidir::undistortPoints(distorted, undist3, this->K, this->D, xi, cv::noArray(),
+        cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 1, 1e-12), iterations);
+    EXPECT_EQ(cv::countNonZero(iterations != 1), 0);
+    EXPECT_EQ(cv::countNonZero(cv::Mat(undist3 != undist3).reshape(1)), 2 * (int)X.total());
+}
+TEST_F(omnidirTest, undistortPointsLUT)
+{
+    cv::Mat distorted(1, 500, CV_64FC2), undist1, undist2, undist3;
+    cv::RNG r;
+    r.fill(distorted, cv::RNG::UNIFORM, cv::Scalar(0.25*imageSize.width, 0.25*imageSize.height),
+        cv::Scalar(0.75*imageSize.width, 0.75*imageSize.height));
+
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi));
+    cv::omnidir::UndistortPointsLUT cubic(this->K, this->D, xi, this->imageSize);
+    cv::omnidir::UndistortPointsLUT linear(this->K, this->D, xi, this->imageSize, cv::Size(64, 48), cv::INTER_LINEAR);
+    EXPECT_LT(cubic.maxError(), 1e-3);
+    EXPECT_LT(cubic.maxError(), linear.maxError());
+
+    cv::omnidir::undistortPoints(distorted, undist1, this->K, this->D, xi, this->om);
+    cubic.undistortPoints(distorted, undist2, this->om);
+    linear.undistortPoints(distorted, undist3, this->om);
+    EXPECT_LT(cv::norm(undist1, undist2, cv::NORM_INF), 5 * cubic.maxError());
+    EXPECT_LT(cv::norm(undist1, undist3, cv::NORM_INF), 5 * linear.maxError());
+}
+TEST_F(omnidirTest, undistortPointsLUTLargeXi)
+{
+    // for xi = 2 the model lifts only the pixels within about 240 pixels of the center
+    cv::Mat distorted(1, 2000, CV_64FC2), undist1, undist2;
+    cv::RNG r;
+    r.fill(distorted, cv::RNG::UNIFORM, cv::Scalar(0, 0), cv::Scalar(imageSize.width, imageSize.height));
+
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(2.0));
+    cv::omnidir::UndistortPointsLUT cubic(this->K, this->D, xi, this->imageSize);
+    EXPECT_FALSE(cvIsNaN(cubic.maxError()));
+    EXPECT_LT(cubic.maxError(), 1e-3);
+
+    cv::omnidir::undistortPoints(distorted, undist1, this->K, this->D, xi, cv::noArray());
+    cubic.undistortPoints(distorted, undist2);
+    int valid = 0;
+    for (int i = 0; i < (int)distorted.total(); ++i)
+    {
+        cv::Vec2d u1 = undist1.at<cv::Vec2d>(i), u2 = undist2.at<cv::Vec2d>(i);
+        if (cvIsNaN(u1[0]))
+        {
+            EXPECT_TRUE(cvIsNaN(u2[0]));
+            continue;
+        }
+        ++valid;
+        EXPECT_LT(cv::norm(u1 - u2), 5 * cubic.maxError() + 1e-9);
+    }
+    EXPECT_GT(valid, 0);
+    EXPECT_LT(valid, (int)distorted.total());
+}
+TEST_F(omnidirTest, undistortPointsVectorized)
+{
+    // large enough for the threaded path, odd for the scalar tail
+    const int n = 20001;
+    cv::Mat distorted(1, n, CV_64FC2), distortedf, undist, undistf, iterations;
+    cv::RNG r;
+    r.fill(distorted, cv::RNG::UNIFORM, cv::Scalar(0, 0), cv::Scalar(imageSize.width, imageSize.height));
+    distorted.convertTo(distortedf, CV_32FC2);
+
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi));
+    cv::TermCriteria criteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 20, 1e-12);
+    cv::omnidir::undistortPoints(distorted, undist, this->K, this->D, xi, this->om, criteria, iterations);
+    cv::omnidir::undistortPoints(distortedf, undistf, this->K, this->D, xi, this->om);
+
+    // single points always take the scalar path
+    for (int i = 0; i < n; i += 97)
+    {
+        cv::Mat u1, uf1, it1;
+        cv::omnidir::undistortPoints(distorted.col(i), u1, this->K, this->D, xi, this->om, criteria, it1);
+        cv::omnidir::undistortPoints(distortedf.col(i), uf1, this->K, this->D, xi, this->om);
+        EXPECT_LE(cv::norm(u1, undist.col(i), cv::NORM_INF), 1e-12 * (1 + cv::norm(u1, cv::NORM_INF)));
+        EXPECT_LE(cv::norm(uf1, undistf.col(i), cv::NORM_INF), 1e-6 * (1 + cv::norm(uf1, cv::NORM_INF)));
+        EXPECT_EQ(it1.at<int>(0), iterations.at<int>(i));
+    }
+}
+TEST_F(omnidirTest, unprojectToSphere)
+{
+    const int n = 101;
+    cv::Mat distorted(1, n, CV_64FC2), sphere, undist;
+    cv::RNG r;
+    r.fill(distorted, cv::RNG::UNIFORM, cv::Scalar(0, 0), cv::Scalar(imageSize.width, imageSize.height));
+
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi));
+    cv::omnidir::unprojectToSphere(distorted, sphere, this->K, this->D, xi, this->om);
+    cv::omnidir::undistortPoints(distorted, undist, this->K, this->D, xi, this->om);
+    EXPECT_EQ(sphere.type(), CV_64FC3);
+
+    // projecting the bearings to the plane gives undistortPoints
+    for (int i = 0; i < n; ++i)
+    {
+        cv::Vec3d Xs = sphere.at<cv::Vec3d>(i);
+        cv::Vec2d xu = undist.at<cv::Vec2d>(i);
+        EXPECT_NEAR(cv::norm(Xs), 1.0, 1e-12);
+        EXPECT_NEAR(Xs[0] / (Xs[2] + this->xi), xu[0], 1e-9);
+        EXPECT_NEAR(Xs[1] / (Xs[2] + this->xi), xu[1], 1e-9);
+    }
+
+    // a point behind the image plane, which the plane representation cannot hold
+    cv::Mat X = (cv::Mat_<cv::Vec3d>(1, 1) << cv::Vec3d(1, 0.2, -0.2)), x, Xs;
+    cv::omnidir::projectPoints(X, x, cv::Vec3d::all(0), cv::Vec3d::all(0), this->K, this->xi, this->D);
+    cv::omnidir::unprojectToSphere(x, Xs, this->K, this->D, xi);
+    EXPECT_LE(cv::norm(Xs.at<cv::Vec3d>(0) - X.at<cv::Vec3d>(0) * (1.0 / cv::norm(X.at<cv::Vec3d>(0)))), 1e-9);
+}
+TEST_F(omnidirTest, fitInverseDistortion)
+{
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi)), Dinv;
+    double error = cv::omnidir::fitInverseDistortion(this->K, this->D, xi, imageSize, Dinv);
+    EXPECT_EQ(Dinv.size(), cv::Size(6, 1));
+    EXPECT_LE(error, 1e-2);
+
+    const int n = 1001;
+    cv::Mat distorted(1, n, CV_64FC2), undist, undistInverse, sphere, sphereInverse;
+    cv::RNG r;
+    r.fill(distorted, cv::RNG::UNIFORM, cv::Scalar(0, 0), cv::Scalar(imageSize.width, imageSize.height));
+
+    cv::omnidir::undistortPoints(distorted, undist, this->K, this->D, xi, this->om);
+    cv::omnidir::undistortPoints(distorted, undistInverse, this->K, this->D, xi, this->om, Dinv);
+    EXPECT_LE(cv::norm(undist, undistInverse, cv::NORM_INF), 1e-6);
+
+    cv::omnidir::unprojectToSphere(distorted, sphere, this->K, this->D, xi, this->om);
+    cv::omnidir::unprojectToSphere(distorted, sphereInverse, this->K, this->D, xi, this->om, Dinv);
+    EXPECT_LE(cv::norm(sphere, sphereInverse, cv::NORM_INF), 1e-6);
+}
+TEST_F(omnidirTest, projectPointsVectorized)
+{
+    // an odd number of points, so that both the vectorized kernel and the scalar tail run
+    const int n = 103;
+    cv::Mat X(1, n, CV_64FC3), Xf;
+    cv::RNG r;
+    r.fill(X, cv::RNG::UNIFORM, -5, 5);
+    X.convertTo(Xf, CV_32FC3);
+
+    cv::Mat x, xf;
+    cv::omnidir::projectPoints(X, x, this->om, this->T, this->K, this->xi, this->D);
+    cv::omnidir::projectPoints(Xf, xf, this->om, this->T, this->K, this->xi, this->D);
+    EXPECT_EQ(xf.type(), CV_32FC2);
+
+    // single points always take the scalar path
+    cv::Mat xScalar(1, n, CV_64FC2), xfScalar(1, n, CV_32FC2);
+    for (int i = 0; i < n; ++i)
+    {
+        cv::Mat xi1, xf1;
+        cv::omnidir::projectPoints(X.col(i), xi1, this->om, this->T, this->K, this->xi, this->D);
+        cv::omnidir::projectPoints(Xf.col(i), xf1, this->om, this->T, this->K, this->xi, this->D);
+        xi1.copyTo(xScalar.col(i));
+        xf1.copyTo(xfScalar.col(i));
+    }
+    EXPECT_LT(cv::norm(x, xScalar, cv::NORM_INF), 1e-10 * cv::norm(xScalar, cv::NORM_INF));
+    EXPECT_LT(cv::norm(xf, xfScalar, cv::NORM_INF), 1e-3);
+}
+TEST_F(omnidirTest, initUndistortRectifyMap)
+{
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi));
+    cv::Mat mapx, mapy, map1, map2, mapx16, mapy16;
+    cv::omnidir::initUndistortRectifyMap(this->K, this->D, xi, this->om, this->K, imageSize, CV_32F, mapx, mapy,
+        cv::omnidir::RECTIFY_PERSPECTIVE);
+    cv::omnidir::initUndistortRectifyMap(this->K, this->D, xi, this->om, this->K, imageSize, CV_16SC2, map1, map2,
+        cv::omnidir::RECTIFY_PERSPECTIVE);
+
+    // each pixel is the projection of its ray
+    cv::Matx33d R;
+    cv::Rodrigues(this->om, R);
+    cv::Matx33d iKR = (this->K * R).inv();
+    for (int y = 0; y < imageSize.height; y += 37)
+    {
+        for (int x = 0; x < imageSize.width; x += 41)
+        {
+            cv::Mat ray(1, 1, CV_64FC3), pixel;
+            ray.at<cv::Vec3d>(0) = iKR * cv::Vec3d(x, y, 1);
+            cv::omnidir::projectPoints(ray, pixel, cv::Vec3d::all(0), cv::Vec3d::all(0), this->K, this->xi, this->D);
+            EXPECT_NEAR(mapx.at<float>(y, x), pixel.at<cv::Vec2d>(0)[0], 1e-3);
+            EXPECT_NEAR(mapy.at<float>(y, x), pixel.at<cv::Vec2d>(0)[1], 1e-3);
+        }
+    }
+
+    // the fixed point maps agree to the interpolation table resolution
+    cv::convertMaps(map1, map2, mapx16, mapy16, CV_32FC1);
+    EXPECT_LE(cv::norm(mapx, mapx16, cv::NORM_INF), 1.0 / cv::INTER_TAB_SIZE);
+    EXPECT_LE(cv::norm(mapy, mapy16, cv::NORM_INF), 1.0 / cv::INTER_TAB_SIZE);
+}
+TEST_F(omnidirTest, initUndistortRectifyMapLongLati)
+{
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi));
+    cv::Size size(1000, 500);
+
+    // without skew the trigonometry is tabulated per row and column, with skew it is not
+    for (int skew = 0; skew < 2; ++skew)
+    {
+        cv::Matx33d Knew(size.width / CV_PI, skew * 0.5, 0,
+                         0, size.height / CV_PI, 0,
+                         0, 0, 1);
+        cv::Mat mapx, mapy;
+        cv::omnidir::initUndistortRectifyMap(this->K, this->D, xi, cv::noArray(), Knew, size, CV_32F, mapx, mapy,
+            cv::omnidir::RECTIFY_LONGLATI);
+
+        cv::Matx33d iK = Knew.inv();
+        for (int y = 0; y < size.height; y += 23)
+        {
+            for (int x = 0; x < size.width; x += 29)
+            {
+                cv::Vec3d th = iK * cv::Vec3d(x, y, 1);
+                double theta = th[0], h = th[1];
+                cv::Mat ray(1, 1, CV_64FC3), pixel;
+                ray.at<cv::Vec3d>(0) = cv::Vec3d(-cos(theta), -sin(theta) * cos(h), sin(theta) * sin(h));
+                cv::omnidir::projectPoints(ray, pixel, cv::Vec3d::all(0), cv::Vec3d::all(0), this->K, this->xi, this->D);
+                EXPECT_NEAR(mapx.at<float>(y, x), pixel.at<cv::Vec2d>(0)[0], 1e-3);
+                EXPECT_NEAR(mapy.at<float>(y, x), pixel.at<cv::Vec2d>(0)[1], 1e-3);
+            }
+        }
+    }
+}
+TEST_F(omnidirTest, initUndistortRectifyMapCylindrical)
+{
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi));
+    cv::Size size(1000, 500);
+
+    // with skew sin and cos are evaluated per pixel
+    for (int skew = 0; skew < 2; ++skew)
+    {
+        cv::Matx33d Knew(size.width / CV_PI, skew * 0.5, 0,
+                         0, size.height / 2.0, 0,
+                         0, 0, 1);
+        cv::Mat mapx, mapy, map1, map2, mapx16, mapy16;
+        cv::omnidir::initUndistortRectifyMap(this->K, this->D, xi, cv::noArray(), Knew, size, CV_32F, mapx, mapy,
+            cv::omnidir::RECTIFY_CYLINDRICAL);
+        cv::omnidir::initUndistortRectifyMap(this->K, this->D, xi, cv::noArray(), Knew, size, CV_16SC2, map1, map2,
+            cv::omnidir::RECTIFY_CYLINDRICAL);
+
+        cv::Matx33d iK = Knew.inv();
+        for (int y = 0; y < size.height; y += 23)
+        {
+            for (int x = 0; x < size.width; x += 29)
+            {
+                cv::Vec3d th = iK * cv::Vec3d(x, y, 1);
+                double theta = th[0], h = th[1];
+                cv::Mat ray(1, 1, CV_64FC3), pixel;
+                ray.at<cv::Vec3d>(0) = cv::Vec3d(cos(theta), sin(theta), h);
+                cv::omnidir::projectPoints(ray, pixel, cv::Vec3d::all(0), cv::Vec3d::all(0), this->K, this->xi, this->D);
+                EXPECT_NEAR(mapx.at<float>(y, x), pixel.at<cv::Vec2d>(0)[0], 1e-3);
+                EXPECT_NEAR(mapy.at<float>(y, x), pixel.at<cv::Vec2d>(0)[1], 1e-3);
+            }
+        }
+
+        cv::convertMaps(map1, map2, mapx16, mapy16, CV_32FC1);
+        EXPECT_LE(cv::norm(mapx, mapx16, cv::NORM_INF), 1.0 / cv::INTER_TAB_SIZE);
+        EXPECT_LE(cv::norm(mapy, mapy16, cv::NORM_INF), 1.0 / cv::INTER_TAB_SIZE);
+    }
+}
+TEST_F(omnidirTest, initUndistortRectifyMapMask)
+{
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi));
+    cv::Size size(1000, 500);
+    cv::Matx33d Knew = longLatiCamera(size);
+    cv::Mat mapx, mapy, expectedx, expectedy, mask;
+    std::vector<cv::Vec3i> spans;
+    cv::omnidir::initUndistortRectifyMap(this->K, this->D, xi, cv::noArray(), Knew, size, CV_32F, mapx, mapy,
+        cv::omnidir::RECTIFY_LONGLATI, imageSize, mask, spans);
+    cv::omnidir::initUndistortRectifyMap(this->K, this->D, xi, cv::noArray(), Knew, size, CV_32F, expectedx, expectedy,
+        cv::omnidir::RECTIFY_LONGLATI);
+    EXPECT_EQ(cv::norm(mapx, expectedx, cv::NORM_INF), 0);
+    EXPECT_EQ(cv::norm(mapy, expectedy, cv::NORM_INF), 0);
+
+    // the half sphere is partly outside the image
+    int count = cv::countNonZero(mask);
+    EXPECT_GT(count, 0);
+    EXPECT_LT(count, size.area());
+
+    // the valid pixels map into the image, and the spans are their runs
+    cv::Mat spanned(size, CV_8U, cv::Scalar(0));
+    for (size_t i = 0; i < spans.size(); ++i)
+    {
+        int y = spans[i][0];
+        EXPECT_LT(spans[i][1], spans[i][2]);
+        EXPECT_TRUE(i == 0 || spans[i - 1][0] < y || spans[i - 1][2] < spans[i][1]);
+        spanned.row(y).colRange(spans[i][1], spans[i][2]).setTo(255);
+    }
+    EXPECT_EQ(cv::norm(spanned, mask, cv::NORM_INF), 0);
+
+    // the valid pixels are those of a ray the model projects one to one that the maps send into the image
+    cv::Matx33d iK = Knew.inv();
+    const double zmin = -std::min(this->xi, 1 / this->xi);
+    int mismatches = 0;
+    for (int y = 0; y < size.height; ++y)
+    {
+        for (int x = 0; x < size.width; ++x)
+        {
+            cv::Vec3d th = iK * cv::Vec3d(x, y, 1);
+            float u = mapx.at<float>(y, x), v = mapy.at<float>(y, x);
+            bool valid = std::sin(th[0]) * std::sin(th[1]) > zmin && u >= 0 && u <= imageSize.width - 1
+                && v >= 0 && v <= imageSize.height - 1;
+            mismatches += valid != (mask.at<uchar>(y, x) != 0);
+        }
+    }
+    EXPECT_EQ(mismatches, 0);
+
+    // the fixed point maps have a mask of their own, almost the same
+    cv::Mat map1, map2, mask16;
+    cv::omnidir::initUndistortRectifyMap(this->K, this->D, xi, cv::noArray(), Knew, size, CV_16SC2, map1, map2,
+        cv::omnidir::RECTIFY_LONGLATI, imageSize, mask16);
+    EXPECT_LT(cv::norm(mask, mask16, cv::NORM_L1), 255.0 * size.height);
+}
+TEST_F(omnidirTest, initUndistortRectifyMapPyramid)
+{
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi));
+    cv::Size size(401, 301);
+    cv::Matx33d Knew(size.width / 4.0, 0, size.width / 2.0,
+                     0, size.height / 4.0, size.height / 2.0,
+                     0, 0, 1);
+    std::vector<cv::Mat> map1, map2;
+    cv::omnidir::initUndistortRectifyMapPyramid(this->K, this->D, xi, cv::noArray(), Knew, size, CV_32F, map1, map2,
+        cv::omnidir::RECTIFY_PERSPECTIVE, 2);
+    ASSERT_EQ(map1.size(), 3u);
+    ASSERT_EQ(map2.size(), 3u);
+    EXPECT_EQ(map1[1].size(), cv::Size(201, 151));
+    EXPECT_EQ(map1[2].size(), cv::Size(101, 76));
+
+    // level 0 is the map of initUndistortRectifyMap, and level l its map for Knew scaled by 2^-l
+    for (int l = 0; l < 3; ++l)
+    {
+        cv::Matx33d Kl = Knew;
+        Kl(0, 0) /= 1 << l; Kl(0, 2) /= 1 << l;
+        Kl(1, 1) /= 1 << l; Kl(1, 2) /= 1 << l;
+        cv::Mat expected1, expected2;
+        cv::omnidir::initUndistortRectifyMap(this->K, this->D, xi, cv::noArray(), Kl, map1[l].size(), CV_32F,
+            expected1, expected2, cv::omnidir::RECTIFY_PERSPECTIVE);
+        EXPECT_LE(cv::norm(map1[l], expected1, cv::NORM_INF), l == 0 ? 0 : 1e-2);
+        EXPECT_LE(cv::norm(map2[l], expected2, cv::NORM_INF), l == 0 ? 0 : 1e-2);
+    }
+
+    // the coarse levels are the fixed point maps of level 0 too
+    cv::omnidir::initUndistortRectifyMapPyramid(this->K, this->D, xi, cv::noArray(), Knew, size, CV_16SC2, map1, map2,
+        cv::omnidir::RECTIFY_PERSPECTIVE, 2);
+    for (int y = 0; y < map1[2].rows; ++y)
+    {
+        for (int x = 0; x < map1[2].cols; ++x)
+        {
+            EXPECT_EQ(map1[2].at<cv::Vec2s>(y, x), map1[0].at<cv::Vec2s>(4 * y, 4 * x));
+            EXPECT_EQ(map2[2].at<ushort>(y, x), map2[0].at<ushort>(4 * y, 4 * x));
+        }
+    }
+
+    cv::Mat distorted = randomImage();
+    std::vector<cv::Mat> undistorted;
+    cv::omnidir::undistortImagePyramid(distorted, undistorted, this->K, this->D, xi, cv::omnidir::RECTIFY_PERSPECTIVE,
+        Knew, 2, size);
+    ASSERT_EQ(undistorted.size(), 3u);
+    cv::Mat expected, mapx, mapy;
+    cv::omnidir::initUndistortRectifyMap(this->K, this->D, xi, cv::noArray(), Knew, size, CV_32F, mapx, mapy,
+        cv::omnidir::RECTIFY_PERSPECTIVE);
+    cv::remap(distorted, expected, mapx, mapy, cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+    EXPECT_EQ(cv::norm(undistorted[0], expected, cv::NORM_INF), 0);
+
+    // the coarse levels are close to the pyrDown of level 0, for an image that level 0 does not alias, at a
+    // scale of about one and of about a half pixel of distorted per pixel of level 0 around the centre
+    cv::resize(randomImage()(cv::Rect(0, 0, 40, 25)), distorted, imageSize, 0, 0, cv::INTER_CUBIC);
+    size = cv::Size(640, 400);
+    for (int k = 0; k < 2; ++k)
+    {
+        double f = this->K(0, 0) / (1 + this->xi) * (1 << k);
+        Knew = cv::Matx33d(f, 0, size.width / 2.0, 0, f, size.height / 2.0, 0, 0, 1);
+        cv::omnidir::undistortImagePyramid(distorted, undistorted, this->K, this->D, xi,
+            cv::omnidir::RECTIFY_PERSPECTIVE, Knew, 2, size);
+        expected = undistorted[0];
+        for (int l = 1; l < 3; ++l)
+        {
+            cv::pyrDown(expected, expected);
+            ASSERT_EQ(undistorted[l].size(), expected.size());
+            cv::Rect centre(expected.cols / 4, expected.rows / 4, expected.cols / 2, expected.rows / 2);
+            EXPECT_LE(cv::norm(undistorted[l](centre), expected(centre), cv::NORM_L1) / (3.0 * centre.area()), 2.0);
+        }
+    }
+}
+TEST_F(omnidirTest, initUndistortRectifyMapCoarse)
+{
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi));
+    cv::Matx33d Knew = longLatiCamera(imageSize);
+    cv::Mat mapx, mapy, coarsex, coarsey, cellError;
+    cv::omnidir::initUndistortRectifyMap(this->K, this->D, xi, this->om, Knew, imageSize, CV_32F, mapx, mapy,
+        cv::omnidir::RECTIFY_LONGLATI);
+
+    // maxError bounds the error at every pixel, with cells that are all interpolated and, for the larger step,
+    // cells that are computed exactly
+    const int steps[] = {8, 32};
+    for (int i = 0; i < 2; ++i)
+    {
+        cv::omnidir::initUndistortRectifyMapCoarse(this->K, this->D, xi, this->om, Knew, imageSize, CV_32F, coarsex,
+            coarsey, cv::omnidir::RECTIFY_LONGLATI, steps[i], 0.1, cellError);
+        EXPECT_EQ(cellError.size(), cv::Size(imageSize.width / steps[i], imageSize.height / steps[i]));
+        EXPECT_LE(cv::norm(cellError, cv::NORM_INF), 0.1);
+        EXPECT_LE(cv::norm(mapx, coarsex, cv::NORM_INF), 0.1);
+        EXPECT_LE(cv::norm(mapy, coarsey, cv::NORM_INF), 0.1);
+    }
+
+    // without tolerance every cell is exact
+    cv::omnidir::initUndistortRectifyMapCoarse(this->K, this->D, xi, this->om, Knew, imageSize, CV_32F, coarsex, coarsey,
+        cv::omnidir::RECTIFY_LONGLATI, 8, 0);
+    EXPECT_EQ(cv::norm(mapx, coarsex, cv::NORM_INF), 0);
+    EXPECT_EQ(cv::norm(mapy, coarsey, cv::NORM_INF), 0);
+}
+TEST_F(omnidirTest, rectifyMapFiles)
+{
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi)), otherXi(1, 1, CV_64F, cv::Scalar(this->xi + 0.01));
+    cv::Mat map1, map2, loaded1, loaded2;
+    cv::omnidir::initUndistortRectifyMap(this->K, this->D, xi, this->om, this->K, imageSize, CV_16SC2, map1, map2,
+        cv::omnidir::RECTIFY_PERSPECTIVE);
+
+    std::string filename = cv::tempfile(".maps");
+    ASSERT_TRUE(cv::omnidir::saveRectifyMaps(filename, this->K, this->D, xi, this->om, this->K, imageSize, map1, map2,
+        cv::omnidir::RECTIFY_PERSPECTIVE));
+    ASSERT_TRUE(cv::omnidir::loadRectifyMaps(filename, this->K, this->D, xi, this->om, this->K, imageSize, CV_16SC2,
+        loaded1, loaded2, cv::omnidir::RECTIFY_PERSPECTIVE));
+    EXPECT_EQ(loaded1.type(), CV_16SC2);
+    EXPECT_EQ(loaded2.type(), CV_16UC1);
+    EXPECT_EQ(cv::norm(map1, loaded1, cv::NORM_INF), 0);
+    EXPECT_EQ(cv::norm(map2, loaded2, cv::NORM_INF), 0);
+
+    // maps of other parameters are not loaded
+    EXPECT_FALSE(cv::omnidir::loadRectifyMaps(filename, this->K, this->D, otherXi, this->om, this->K, imageSize, CV_16SC2,
+        loaded1, loaded2, cv::omnidir::RECTIFY_PERSPECTIVE));
+    EXPECT_FALSE(cv::omnidir::loadRectifyMaps(filename, this->K, this->D, xi, this->om, this->K, imageSize, CV_32F,
+        loaded1, loaded2, cv::omnidir::RECTIFY_PERSPECTIVE));
+    loaded1.release();
+    loaded2.release();
+
+    // saving again replaces the file
+    cv::omnidir::initUndistortRectifyMap(this->K, this->D, otherXi, this->om, this->K, imageSize, CV_16SC2, map1, map2,
+        cv::omnidir::RECTIFY_PERSPECTIVE);
+    ASSERT_TRUE(cv::omnidir::saveRectifyMaps(filename, this->K, this->D, otherXi, this->om, this->K, imageSize, map1,
+        map2, cv::omnidir::RECTIFY_PERSPECTIVE));
+    ASSERT_TRUE(cv::omnidir::loadRectifyMaps(filename, this->K, this->D, otherXi, this->om, this->K, imageSize, CV_16SC2,
+        loaded1, loaded2, cv::omnidir::RECTIFY_PERSPECTIVE));
+    EXPECT_EQ(cv::norm(map1, loaded1, cv::NORM_INF), 0);
+    EXPECT_EQ(cv::norm(map2, loaded2, cv::NORM_INF), 0);
+    loaded1.release();
+    loaded2.release();
+    std::remove(filename.c_str());
+}
+TEST_F(omnidirTest, initUndistortRectifyMapROI)
+{
+    cv::Mat distorted = randomImage(), undistorted, expected;
+
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi));
+    cv::Size size(1001, 499);
+    cv::Rect roi(413, 97, 150, 101);
+    cv::Matx33d Knew = longLatiCamera(size);
+    for (int i = 0; i < 2; ++i)
+    {
+        int m1type = i == 0 ? CV_16SC2 : CV_32F;
+        cv::Mat map1, map2, roi1, roi2;
+        cv::omnidir::initUndistortRectifyMap(this->K, this->D, xi, cv::noArray(), Knew, size, m1type, map1, map2,
+            cv::omnidir::RECTIFY_LONGLATI);
+        cv::Rect box = cv::omnidir::initUndistortRectifyMapROI(this->K, this->D, xi, cv::noArray(), Knew, roi,
+            imageSize, m1type, roi1, roi2, cv::omnidir::RECTIFY_LONGLATI);
+        EXPECT_EQ(cv::norm(roi1, map1(roi), cv::NORM_INF), 0);
+        EXPECT_EQ(cv::norm(roi2, map2(roi), cv::NORM_INF), 0);
+        EXPECT_GT(box.area(), 0);
+        EXPECT_LT(box.area(), imageSize.area() / 4);
+
+        // the part of the image in the box is enough for the relative maps
+        cv::remap(distorted, expected, roi1, roi2, cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+        cv::Rect relativeBox = cv::omnidir::initUndistortRectifyMapROI(this->K, this->D, xi, cv::noArray(), Knew, roi,
+            imageSize, m1type, roi1, roi2, cv::omnidir::RECTIFY_LONGLATI, true);
+        EXPECT_EQ(relativeBox, box);
+        cv::remap(distorted(box).clone(), undistorted, roi1, roi2, cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+        EXPECT_EQ(cv::norm(undistorted, expected, cv::NORM_INF), 0);
+    }
+
+    // the rectangle of undistortImage
+    cv::omnidir::undistortImage(distorted, expected, this->K, this->D, xi, cv::omnidir::RECTIFY_LONGLATI, Knew, size);
+    cv::omnidir::undistortImageROI(distorted, undistorted, this->K, this->D, xi, cv::omnidir::RECTIFY_LONGLATI, Knew, roi);
+    EXPECT_EQ(cv::norm(undistorted, expected(roi), cv::NORM_INF), 0);
+}
+TEST_F(omnidirTest, Undistorter)
+{
+    cv::Mat distorted = randomImage(), undistorted, expected;
+
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi));
+    cv::Matx33d Knew(imageSize.width / 4.0, 0, imageSize.width / 2.0,
+                     0, imageSize.height / 4.0, imageSize.height / 2.0,
+                     0, 0, 1);
+    cv::Mat map1, map2;
+    cv::omnidir::initUndistortRectifyMap(this->K, this->D, xi, cv::Mat::eye(3, 3, CV_64F), Knew, imageSize, CV_16SC2,
+        map1, map2, cv::omnidir::RECTIFY_PERSPECTIVE);
+    cv::remap(distorted, expected, map1, map2, cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+
+    // maps built on the first image, then reused
+    cv::omnidir::Undistorter undistorter(this->K, this->D, xi, cv::omnidir::RECTIFY_PERSPECTIVE, Knew);
+    EXPECT_TRUE(undistorter.map1().empty());
+    undistorter.apply(distorted, undistorted);
+    EXPECT_EQ(cv::norm(undistorted, expected, cv::NORM_INF), 0);
+    const uchar* data = undistorter.map1().data;
+    undistorter.apply(distorted, undistorted);
+    EXPECT_EQ(undistorter.map1().data, data);
+    EXPECT_EQ(cv::norm(map1, undistorter.map1(), cv::NORM_INF), 0);
+    EXPECT_EQ(cv::norm(map2, undistorter.map2(), cv::NORM_INF), 0);
+
+    // undistortImage gives the same image, also when its cached maps are reused
+    for (int i = 0; i < 2; ++i)
+    {
+        cv::omnidir::undistortImage(distorted, undistorted, this->K, this->D, xi, cv::omnidir::RECTIFY_PERSPECTIVE, Knew);
+        EXPECT_EQ(cv::norm(undistorted, expected, cv::NORM_INF), 0);
+    }
+}
+TEST_F(omnidirTest, rectifyImage)
+{
+    // a size that is not a multiple of the tiles
+    cv::Mat distorted = randomImage(), undistorted, expected;
+
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi));
+    cv::Size newSize(1001, 299);
+    cv::Matx33d Knew = longLatiCamera(newSize);
+    cv::omnidir::undistortImage(distorted, expected, this->K, this->D, xi, cv::omnidir::RECTIFY_LONGLATI, Knew, newSize);
+    cv::omnidir::rectifyImage(distorted, undistorted, this->K, this->D, xi, cv::omnidir::RECTIFY_LONGLATI, Knew, newSize);
+    EXPECT_EQ(undistorted.size(), newSize);
+    EXPECT_EQ(cv::norm(undistorted, expected, cv::NORM_INF), 0);
+}
+TEST_F(omnidirTest, CubemapRenderer)
+{
+    cv::Mat distorted = randomImage(), packed, cross, subset;
+
+    typedef cv::omnidir::CubemapRenderer Cubemap;
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi));
+    const int n = 101;
+    Cubemap cubemap(this->K, this->D, xi, n, this->om);
+    cubemap.render(distorted, packed);
+    cubemap.render(distorted, cross, Cubemap::LAYOUT_CROSS);
+    EXPECT_EQ(packed.size(), cv::Size(n, 6 * n));
+    EXPECT_EQ(cross.size(), cv::Size(4 * n, 3 * n));
+
+    // each face is the perspective rectification by its rotation, and the same in both layouts
+    cv::Matx33d Knew(n / 2.0, 0, (n - 1) / 2.0,
+                     0, n / 2.0, (n - 1) / 2.0,
+                     0, 0, 1);
+    for (int face = 0; face < Cubemap::FACE_COUNT; ++face)
+    {
+        cv::Mat expected;
+        cv::omnidir::undistortImage(distorted, expected, this->K, this->D, xi, cv::omnidir::RECTIFY_PERSPECTIVE, Knew,
+            cv::Size(n, n), cubemap.faceRotation(face));
+        EXPECT_EQ(cv::norm(packed(cubemap.faceRect(face)), expected, cv::NORM_INF), 0);
+        EXPECT_EQ(cv::norm(cross(cubemap.faceRect(face, Cubemap::LAYOUT_CROSS)), expected, cv::NORM_INF), 0);
+    }
+    EXPECT_EQ(cv::norm(cross(cv::Rect(0, 0, n, n)), cv::NORM_INF), 0);
+
+    // a subset of the faces into a new buffer leaves the others cleared, into a reused one unchanged
+    int faces = (1 << Cubemap::FACE_POSITIVE_Z) | (1 << Cubemap::FACE_NEGATIVE_Y);
+    cubemap.render(distorted, subset, Cubemap::LAYOUT_PACKED, faces);
+    for (int face = 0; face < Cubemap::FACE_COUNT; ++face)
+    {
+        cv::Rect rect = cubemap.faceRect(face);
+        if (faces & (1 << face))
+            EXPECT_EQ(cv::norm(subset(rect), packed(rect), cv::NORM_INF), 0);
+        else
+            EXPECT_EQ(cv::norm(subset(rect), cv::NORM_INF), 0);
+    }
+    packed.copyTo(subset);
+    cubemap.render(cv::Mat::zeros(imageSize, CV_8UC3), subset, Cubemap::LAYOUT_PACKED, 1 << Cubemap::FACE_POSITIVE_X);
+    EXPECT_EQ(cv::norm(subset(cubemap.faceRect(Cubemap::FACE_POSITIVE_X)), cv::NORM_INF), 0);
+    EXPECT_EQ(cv::norm(subset(cubemap.faceRect(Cubemap::FACE_NEGATIVE_X)), packed(cubemap.faceRect(Cubemap::FACE_NEGATIVE_X)),
+        cv::NORM_INF), 0);
+}
+TEST_F(omnidirTest, VirtualCamera)
+{
+    cv::Mat distorted = randomImage(), undistorted, rendered;
+
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi));
+    cv::Size newSize(301, 203);
+    cv::Matx33d Knew(newSize.width / 2.0, 0, newSize.width / 2.0,
+                     0, newSize.width / 2.0, newSize.height / 2.0,
+                     0, 0, 1);
+    cv::omnidir::VirtualCamera camera(this->K, this->D, xi, cv::omnidir::RECTIFY_PERSPECTIVE, Knew, newSize);
+
+    // the maps of each rotation agree with initUndistortRectifyMap to the interpolation table resolution
+    for (int i = 0; i < 3; ++i)
+    {
+        cv::Vec3d om(0.1 * i, -0.2 * i, 0.05);
+        camera.setRotation(om);
+
+        cv::Mat map1, map2, mapx, mapy, expectedx, expectedy;
+        cv::omnidir::initUndistortRectifyMap(this->K, this->D, xi, om, Knew, newSize, CV_32F, expectedx, expectedy,
+            cv::omnidir::RECTIFY_PERSPECTIVE);
+        cv::convertMaps(camera.map1(), camera.map2(), mapx, mapy, CV_32FC1);
+        EXPECT_LE(cv::norm(mapx, expectedx, cv::NORM_INF), 1.0 / cv::INTER_TAB_SIZE);
+        EXPECT_LE(cv::norm(mapy, expectedy, cv::NORM_INF), 1.0 / cv::INTER_TAB_SIZE);
+
+        // rendering in one pass gives the same maps and image
+        camera.apply(distorted, undistorted);
+        map1 = camera.map1().clone();
+        map2 = camera.map2().clone();
+        camera.setRotation(cv::Vec3d::all(0));
+        camera.render(distorted, rendered, om);
+        EXPECT_EQ(cv::norm(map1, camera.map1(), cv::NORM_INF), 0);
+        EXPECT_EQ(cv::norm(map2, camera.map2(), cv::NORM_INF), 0);
+        EXPECT_EQ(cv::norm(undistorted, rendered, cv::NORM_INF), 0);
+    }
+}
+TEST_F(omnidirTest, ViewportRenderer)
+{
+    cv::Mat distorted = randomImage();
+
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi));
+    std::vector<cv::omnidir::Viewport> viewports;
+    for (int i = 0; i < 4; ++i)
+    {
+        cv::Size size(200 + 33 * i, 150 + 17 * i);
+        cv::Matx33d Knew(size.width / 2.0, 0, size.width / 2.0,
+                         0, size.width / 2.0, size.height / 2.0,
+                         0, 0, 1);
+        cv::Matx33d R;
+        cv::Rodrigues(cv::Vec3d(0.1 * i, -0.2 * i, 0), R);
+        viewports.push_back(cv::omnidir::Viewport(Knew, R, size));
+    }
+    viewports.push_back(cv::omnidir::Viewport(longLatiCamera(cv::Size(300, 100)),
+        cv::Matx33d::eye(), cv::Size(300, 100), cv::omnidir::RECTIFY_LONGLATI));
+
+    cv::omnidir::ViewportRenderer renderer(this->K, this->D, xi, viewports);
+    std::vector<cv::Mat> views;
+    renderer.render(distorted, views);
+    ASSERT_EQ(views.size(), viewports.size());
+
+    // each view is the one of undistortImage, and is rendered again into the same buffer
+    std::vector<const uchar*> data;
+    for (size_t i = 0; i < viewports.size(); ++i)
+    {
+        cv::Mat expected;
+        cv::omnidir::undistortImage(distorted, expected, this->K, this->D, xi, viewports[i].flags, viewports[i].Knew,
+            viewports[i].size, viewports[i].R);
+        EXPECT_EQ(cv::norm(views[i], expected, cv::NORM_INF), 0);
+        data.push_back(views[i].data);
+    }
+    renderer.render(distorted, views);
+    for (size_t i = 0; i < viewports.size(); ++i)
+        EXPECT_EQ(views[i].data, data[i]);
+
+    // the views may be regions of one canvas, side by side
+    cv::Mat canvas(cv::Size(1300, 201), distorted.type(), cv::Scalar::all(0));
+    std::vector<cv::Rect> regions;
+    int x = 0;
+    for (size_t i = 0; i < viewports.size(); ++i)
+    {
+        regions.push_back(cv::Rect(cv::Point(x, 0), viewports[i].size));
+        views[i] = canvas(regions[i]);
+        x += viewports[i].size.width;
+    }
+    renderer.render(distorted, views);
+    for (size_t i = 0; i < viewports.size(); ++i)
+    {
+        EXPECT_EQ(views[i].data, canvas(regions[i]).data);
+        cv::Mat expected;
+        cv::omnidir::undistortImage(distorted, expected, this->K, this->D, xi, viewports[i].flags, viewports[i].Knew,
+            viewports[i].size, viewports[i].R);
+        EXPECT_EQ(cv::norm(canvas(regions[i]), expected, cv::NORM_INF), 0);
+    }
+}
+TEST_F(omnidirTest, TiledRemapper)
+{
+    cv::Mat distorted = randomImage(), undistorted, expected;
+
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi));
+    cv::Size size(1001, 499);
+    cv::Matx33d Knew = longLatiCamera(size);
+    for (int i = 0; i < 2; ++i)
+    {
+        cv::Mat map1, map2;
+        cv::omnidir::initUndistortRectifyMap(this->K, this->D, xi, cv::noArray(), Knew, size, i == 0 ? CV_16SC2 : CV_32F,
+            map1, map2, cv::omnidir::RECTIFY_LONGLATI);
+        cv::omnidir::TiledRemapper remapper(map1, map2);
+
+        // the tiles cover the output once, and their source boxes hold their source pixels
+        cv::Mat covered(size, CV_8U, cv::Scalar(0));
+        for (int t = 0; t < remapper.tiles(); ++t)
+        {
+            cv::Rect tile = remapper.tile(t), source = remapper.sourceRect(t);
+            covered(tile) += 1;
+
+            cv::Mat mapx, mapy;
+            cv::convertMaps(map1(tile), map2(tile), mapx, mapy, CV_32FC1);
+            double minx, maxx, miny, maxy;
+            cv::minMaxLoc(mapx, &minx, &maxx);
+            cv::minMaxLoc(mapy, &miny, &maxy);
+            EXPECT_LE(source.x, cvFloor(minx));
+            EXPECT_LE(source.y, cvFloor(miny));
+            EXPECT_GE(source.x + source.width, cvFloor(maxx) + 1);
+            EXPECT_GE(source.y + source.height, cvFloor(maxy) + 1);
+        }
+        EXPECT_EQ(cv::countNonZero(covered != 1), 0);
+
+        // the image is the one of cv::remap
+        cv::remap(distorted, expected, map1, map2, cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+        remapper.remap(distorted, undistorted);
+        EXPECT_EQ(cv::norm(undistorted, expected, cv::NORM_INF), 0);
+    }
+}
+TEST_F(omnidirTest, CompactMap)
+{
+    cv::Mat distorted = randomImage(), undistorted, expected;
+
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi));
+    cv::Size size(1001, 499);
+    cv::Matx33d Knew = longLatiCamera(size);
+    cv::Mat map1, map2, mapx, mapy, decoded1, decoded2;
+    cv::omnidir::initUndistortRectifyMap(this->K, this->D, xi, cv::noArray(), Knew, size, CV_16SC2, map1, map2,
+        cv::omnidir::RECTIFY_LONGLATI);
+    cv::remap(distorted, expected, map1, map2, cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+
+    // the encoding is lossless and less than half the size
+    cv::omnidir::CompactMap compact;
+    compact.create(this->K, this->D, xi, cv::noArray(), Knew, size, cv::omnidir::RECTIFY_LONGLATI);
+    EXPECT_EQ(compact.size(), size);
+    EXPECT_LT(compact.memorySize(), (map1.total() * map1.elemSize() + map2.total() * map2.elemSize()) / 2);
+    compact.decode(decoded1, decoded2);
+    EXPECT_EQ(cv::norm(decoded1, map1, cv::NORM_INF), 0);
+    EXPECT_EQ(cv::norm(decoded2, map2, cv::NORM_INF), 0);
+
+    compact.remap(distorted, undistorted);
+    EXPECT_EQ(cv::norm(undistorted, expected, cv::NORM_INF), 0);
+
+    // float maps are rounded as by convertMaps, and any grid step works
+    cv::convertMaps(map1, map2, mapx, mapy, CV_32FC1);
+    for (int step = 2; step <= 16; step *= 2)
+    {
+        compact.create(mapx, mapy, step);
+        compact.decode(decoded1, decoded2);
+        EXPECT_EQ(cv::norm(decoded1, map1, cv::NORM_INF), 0);
+        EXPECT_EQ(cv::norm(decoded2, map2, cv::NORM_INF), 0);
+    }
+
+    // CV_16SC2 maps without the second map have zero fractions
+    compact.create(map1, cv::noArray());
+    compact.decode(decoded1, decoded2);
+    EXPECT_EQ(cv::norm(decoded1, map1, cv::NORM_INF), 0);
+    EXPECT_EQ(cv::countNonZero(decoded2), 0);
+    compact.remap(distorted, undistorted, cv::INTER_NEAREST);
+    cv::remap(distorted, expected, map1, cv::noArray(), cv::INTER_NEAREST, cv::BORDER_CONSTANT);
+    EXPECT_EQ(cv::norm(undistorted, expected, cv::NORM_INF), 0);
+}
 TEST_F(omnidirTest, jacobian)
 {
     int n = 10;
@@ -202,6 +996,248 @@ TEST_F(omnidirTest, jacobian)
     EXPECT_LT(cv::norm(x2 - xpred), 1e-10);
 }
 
+TEST_F(omnidirTest, jacobianFixedParameters)
+{
+    cv::Mat X(1, 50, CV_64FC3);
+    cv::RNG r;
+    r.fill(X, cv::RNG::UNIFORM, -5, 5);
+
+    cv::Mat x1, x2, J1, J2;
+    int flags = cv::omnidir::CALIB_FIX_SKEW + cv::omnidir::CALIB_FIX_XI + cv::omnidir::CALIB_FIX_P1 + cv::omnidir::CALIB_FIX_P2;
+    cv::omnidir::projectPoints(X, x1, this->om, this->T, this->K, this->xi, this->D, J1);
+    cv::omnidir::internal::projectPoints(X, x2, this->om, this->T, this->K, this->xi, this->D, J2, flags);
+
+    EXPECT_EQ(cv::norm(x1, x2, cv::NORM_INF), 0);
+
+    // columns om, T, f, c and k1, k2 are live, s, xi, p1 and p2 are not computed
+    int live[] = {0, 1, 2, 3, 4, 5, 6, 7, 9, 10, 12, 13};
+    for (int i = 0; i < (int)(sizeof(live)/sizeof(live[0])); ++i)
+        EXPECT_LT(cv::norm(J1.col(live[i]), J2.col(live[i]), cv::NORM_INF), 1e-12 * (1 + cv::norm(J1.col(live[i]), cv::NORM_INF)));
+    EXPECT_EQ(cv::countNonZero(J2.col(8)), 0);
+    EXPECT_EQ(cv::countNonZero(J2.col(11)), 0);
+    EXPECT_EQ(cv::countNonZero(J2.colRange(14, 16)), 0);
+}
+
+TEST_F(omnidirTest, jacobianMixedPrecision)
+{
+    cv::Mat X(1, 50, CV_64FC3);
+    cv::RNG r;
+    r.fill(X, cv::RNG::UNIFORM, -5, 5);
+
+    cv::Mat x1, x2, J1, J2;
+    int flags = cv::omnidir::CALIB_FIX_SKEW;
+    cv::omnidir::internal::projectPoints(X, x1, this->om, this->T, this->K, this->xi, this->D, J1, flags);
+    cv::omnidir::internal::projectPoints(X, x2, this->om, this->T, this->K, this->xi, this->D, J2,
+        flags | cv::omnidir::CALIB_MIXED_PRECISION);
+
+    EXPECT_LT(cv::norm(x1, x2, cv::NORM_INF), 1e-3);
+    for (int i = 0; i < J1.cols; ++i)
+        EXPECT_LT(cv::norm(J1.col(i), J2.col(i), cv::NORM_INF), 1e-5 * (1 + cv::norm(J1.col(i), cv::NORM_INF)));
+    EXPECT_EQ(cv::countNonZero(J2.col(8)), 0);
+}
+
+TEST_F(omnidirTest, computeJacobianNormalEquations)
+{
+    // a few views of a random pattern, with noisy image points so that the error is not zero
+    cv::RNG r;
+    const int n = 3, nPoints = 30;
+    std::vector<cv::Mat> objectPoints, imagePoints;
+    std::vector<cv::Vec3d> omAll, tAll;
+    for (int i = 0; i < n; ++i)
+    {
+        cv::Mat X(1, nPoints, CV_64FC3), x, noise(1, nPoints, CV_64FC2);
+        r.fill(X, cv::RNG::UNIFORM, cv::Scalar(-0.5, -0.5, 0), cv::Scalar(0.5, 0.5, 0.2));
+        r.fill(noise, cv::RNG::NORMAL, 0, 0.5);
+        omAll.push_back(cv::Vec3d(r.uniform(-0.4, 0.4), r.uniform(-0.4, 0.4), r.uniform(-0.2, 0.2)));
+        tAll.push_back(cv::Vec3d(r.uniform(-0.2, 0.2), r.uniform(-0.2, 0.2), r.uniform(0.8, 1.2)));
+        cv::omnidir::projectPoints(X, x, omAll[i], tAll[i], this->K, this->xi, this->D);
+        objectPoints.push_back(X);
+        imagePoints.push_back(x + noise);
+    }
+    cv::Mat parameters;
+    cv::omnidir::internal::encodeParameters(cv::Mat(this->K), omAll, tAll, cv::Mat(this->D), this->xi, parameters);
+
+    // the explicit jacobian, with the extrinsic columns of view i at 6i and the intrinsic ones at 6n
+    cv::Mat J = cv::Mat::zeros(2 * n * nPoints, 6 * n + 10, CV_64F), e(2 * n * nPoints, 1, CV_64F);
+    for (int i = 0; i < n; ++i)
+    {
+        cv::Mat x, jacobian;
+        cv::omnidir::projectPoints(objectPoints[i], x, omAll[i], tAll[i], this->K, this->xi, this->D, jacobian);
+        cv::Range rows(2 * i * nPoints, 2 * (i + 1) * nPoints);
+        jacobian.colRange(0, 6).copyTo(J(rows, cv::Range(6 * i, 6 * i + 6)));
+        jacobian.colRange(6, 16).copyTo(J(rows, cv::Range(6 * n, 6 * n + 10)));
+        cv::Mat(imagePoints[i] - x).reshape(1, 2 * nPoints).copyTo(e.rowRange(rows));
+    }
+
+    int flags[] = { 0,
+        cv::omnidir::CALIB_FIX_SKEW + cv::omnidir::CALIB_FIX_XI + cv::omnidir::CALIB_FIX_K1 + cv::omnidir::CALIB_FIX_K2
+            + cv::omnidir::CALIB_FIX_P1 + cv::omnidir::CALIB_FIX_P2,
+        cv::omnidir::CALIB_FIX_K1 + cv::omnidir::CALIB_FIX_P2 + cv::omnidir::CALIB_FIX_CENTER };
+    for (int k = 0; k < (int)(sizeof(flags)/sizeof(flags[0])); ++k)
+    {
+        std::vector<int> idx;
+        cv::omnidir::internal::flags2idx(flags[k], idx, n);
+        cv::Mat expectedJTJ, expectedJTE;
+        cv::omnidir::internal::subMatrix(cv::Mat(J.t() * J), expectedJTJ, idx, idx);
+        cv::omnidir::internal::subMatrix(cv::Mat(J.t() * e), expectedJTE, std::vector<int>(1, 1), idx);
+
+        cv::Mat JTJ_inv, JTE;
+        cv::omnidir::internal::computeJacobian(objectPoints, imagePoints, parameters, JTJ_inv, JTE, flags[k], 0);
+        ASSERT_EQ(JTJ_inv.size(), expectedJTJ.size());
+        ASSERT_EQ(JTE.size(), expectedJTE.size());
+        EXPECT_LE(cv::norm(JTJ_inv.inv(), expectedJTJ, cv::NORM_INF), 1e-4 * cv::norm(expectedJTJ, cv::NORM_INF));
+        EXPECT_LE(cv::norm(JTE, expectedJTE, cv::NORM_INF), 1e-9 * cv::norm(expectedJTE, cv::NORM_INF));
+    }
+}
+
+TEST_F(omnidirTest, calibrateMixedPrecision)
+{
+    // a synthetic planar pattern seen from a few poses
+    cv::Mat pattern(1, 8 * 6, CV_64FC3);
+    for (int i = 0; i < (int)pattern.total(); ++i)
+        pattern.at<cv::Vec3d>(i) = cv::Vec3d(0.05 * (i % 8), 0.05 * (i / 8), 0);
+
+    cv::RNG r;
+    std::vector<cv::Mat> objectPoints, imagePoints;
+    for (int i = 0; i < 8; ++i)
+    {
+        cv::Vec3d rvec(r.uniform(-0.4, 0.4), r.uniform(-0.4, 0.4), r.uniform(-0.2, 0.2));
+        cv::Vec3d tvec(r.uniform(-0.3, -0.1), r.uniform(-0.2, -0.05), r.uniform(0.3, 0.6));
+        cv::Mat x;
+        cv::omnidir::projectPoints(pattern, x, rvec, tvec, this->K, this->xi, this->D);
+        objectPoints.push_back(pattern);
+        imagePoints.push_back(x);
+    }
+
+    cv::TermCriteria criteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 200, 1e-8);
+    int flags = cv::omnidir::CALIB_FIX_SKEW;
+    double step = -1;
+    cv::Mat K, xi, D;
+    std::vector<cv::Vec3d> rvecs, tvecs;
+    double rms = cv::omnidir::calibrate(objectPoints, imagePoints, this->imageSize, K, xi, D, rvecs, tvecs, flags,
+        criteria, cv::noArray(), step);
+    EXPECT_LT(rms, 1);
+    EXPECT_EQ(step, 0);
+
+    cv::Mat Kf, xif, Df;
+    double rmsf = cv::omnidir::calibrate(objectPoints, imagePoints, this->imageSize, Kf, xif, Df, rvecs, tvecs,
+        flags | cv::omnidir::CALIB_MIXED_PRECISION, criteria, cv::noArray(), step);
+    EXPECT_LT(rmsf, 1);
+    EXPECT_GT(step, 0);
+    EXPECT_LT(step, 1e-4);
+}
+
+TEST_F(omnidirTest, stereoCalibrateMixedPrecision)
+{
+    // a synthetic planar pattern seen by a rig whose second camera is shifted along x
+    cv::Mat pattern(1, 8 * 6, CV_64FC3);
+    for (int i = 0; i < (int)pattern.total(); ++i)
+        pattern.at<cv::Vec3d>(i) = cv::Vec3d(0.05 * (i % 8), 0.05 * (i / 8), 0);
+
+    cv::Matx33d R;
+    cv::Rodrigues(cv::Vec3d(0.02, -0.03, 0.01), R);
+    cv::Vec3d T(-0.1, 0.005, 0.002);
+
+    cv::RNG r;
+    std::vector<cv::Mat> objectPoints, imagePoints1, imagePoints2;
+    for (int i = 0; i < 8; ++i)
+    {
+        cv::Vec3d rvec1(r.uniform(-0.4, 0.4), r.uniform(-0.4, 0.4), r.uniform(-0.2, 0.2));
+        cv::Vec3d tvec1(r.uniform(-0.2, 0), r.uniform(-0.2, -0.05), r.uniform(0.3, 0.6));
+        cv::Matx33d R1;
+        cv::Rodrigues(rvec1, R1);
+        cv::Vec3d rvec2, tvec2 = R * tvec1 + T;
+        cv::Rodrigues(R * R1, rvec2);
+        cv::Mat x1, x2;
+        cv::omnidir::projectPoints(pattern, x1, rvec1, tvec1, this->K, this->xi, this->D);
+        cv::omnidir::projectPoints(pattern, x2, rvec2, tvec2, this->K, this->xi, this->D);
+        objectPoints.push_back(pattern);
+        imagePoints1.push_back(x1);
+        imagePoints2.push_back(x2);
+    }
+
+    cv::TermCriteria criteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 200, 1e-8);
+    int flags = cv::omnidir::CALIB_FIX_SKEW;
+    double step = -1;
+    cv::Mat K1, xi1, D1, K2, xi2, D2;
+    cv::Vec3d om, t;
+    std::vector<cv::Vec3d> omL, tL;
+    double rms = cv::omnidir::stereoCalibrate(objectPoints, imagePoints1, imagePoints2, this->imageSize, this->imageSize,
+        K1, xi1, D1, K2, xi2, D2, om, t, omL, tL, flags, criteria, cv::noArray(), step);
+    EXPECT_LT(rms, 1);
+    EXPECT_EQ(step, 0);
+
+    double rmsf = cv::omnidir::stereoCalibrate(objectPoints, imagePoints1, imagePoints2, this->imageSize, this->imageSize,
+        K1, xi1, D1, K2, xi2, D2, om, t, omL, tL, flags | cv::omnidir::CALIB_MIXED_PRECISION, criteria, cv::noArray(), step);
+    EXPECT_LT(rmsf, 1);
+    EXPECT_GT(step, 0);
+    EXPECT_LT(step, 1e-4);
+}
+
+TEST_F(omnidirTest, projectPointsBatch)
+{
+    const int nViews = 7;
+    cv::RNG r;
+    std::vector<cv::Mat> objectPoints(nViews);
+    std::vector<cv::Vec3d> rvecs(nViews), tvecs(nViews);
+    for (int i = 0; i < nViews; ++i)
+    {
+        // ragged views
+        objectPoints[i].create(1, 20 + 3*i, CV_64FC3);
+        r.fill(objectPoints[i], cv::RNG::UNIFORM, -5, 5);
+        rvecs[i] = this->om + cv::Vec3d(r.uniform(-0.2, 0.2), r.uniform(-0.2, 0.2), r.uniform(-0.2, 0.2));
+        tvecs[i] = this->T + cv::Vec3d(r.uniform(-1., 1.), r.uniform(-1., 1.), r.uniform(-1., 1.));
+    }
+
+    cv::Mat x, xShared;
+    cv::omnidir::projectPointsBatch(objectPoints, x, rvecs, tvecs, this->K, this->xi, this->D);
+    cv::omnidir::projectPointsBatch(objectPoints[0], xShared, rvecs, tvecs, this->K, this->xi, this->D);
+    EXPECT_EQ(x.type(), CV_64FC2);
+    EXPECT_EQ(xShared.total(), objectPoints[0].total() * nViews);
+
+    int offset = 0;
+    for (int i = 0; i < nViews; ++i)
+    {
+        int n = (int)objectPoints[i].total();
+        cv::Mat xi1, xi2;
+        cv::omnidir::projectPoints(objectPoints[i], xi1, rvecs[i], tvecs[i], this->K, this->xi, this->D);
+        cv::omnidir::projectPoints(objectPoints[0], xi2, rvecs[i], tvecs[i], this->K, this->xi, this->D);
+        EXPECT_EQ(cv::norm(xi1, x.colRange(offset, offset + n), cv::NORM_INF), 0);
+        EXPECT_EQ(cv::norm(xi2, xShared.colRange(i * xi2.cols, (i + 1) * xi2.cols), cv::NORM_INF), 0);
+        offset += n;
+    }
+}
+
+TEST_F(omnidirTest, stereoReconstructVignette)
+{
+    // the black ring of a fisheye frame, inside the image rectangle
+    cv::Mat image = randomImage();
+    cv::Mat ring(imageSize, CV_8U, cv::Scalar(255));
+    cv::circle(ring, cv::Point(cvRound(this->K(0, 2)), cvRound(this->K(1, 2))), 350, cv::Scalar(0), -1);
+    image.setTo(cv::Scalar::all(0), ring);
+
+    cv::Mat xi(1, 1, CV_64F, cv::Scalar(this->xi));
+    cv::Size size(400, 200);
+    cv::Mat disparity, image1Rec, image2Rec, pointCloud, black;
+    cv::omnidir::stereoReconstruct(image, image, this->K, this->D, xi, this->K, this->D, xi, cv::Vec3d::all(0),
+        cv::Vec3d(-0.1, 0, 0), cv::omnidir::RECTIFY_LONGLATI, 16, 5, disparity, image1Rec, image2Rec, size,
+        longLatiCamera(size), pointCloud, cv::omnidir::XYZ);
+
+    // no disparity at the black pixels of the first image, nor outside its mask
+    cv::inRange(image1Rec, cv::Scalar::all(0), cv::Scalar::all(0), black);
+    EXPECT_GT(cv::countNonZero(black), 0);
+    EXPECT_EQ(cv::countNonZero((disparity != 0) & black), 0);
+
+    cv::Mat R1, R2, map1, map2, mask;
+    cv::omnidir::stereoRectify(cv::Vec3d::all(0), cv::Vec3d(-0.1, 0, 0), R1, R2);
+    cv::omnidir::initUndistortRectifyMap(this->K, this->D, xi, R1, longLatiCamera(size), size, CV_16SC2, map1, map2,
+        cv::omnidir::RECTIFY_LONGLATI, imageSize, mask);
+    EXPECT_EQ(cv::countNonZero((disparity != 0) & (mask == 0)), 0);
+
+    // one point per pixel of disparity above 15
+    EXPECT_EQ((int)pointCloud.total(), cv::countNonZero(disparity > 15));
+}
+
 //TEST_F(omnidirTest, calibration)
 //{
 //    // load pattern points and image points, you should assign your path of the corner file.
@@ -331,6 +1367,21 @@ const cv::Vec3d omnidirTest::T(-9.9217369356044638e-02, 3.1741831972356663e-03,
 
 const double omnidirTest::xi = 1.05343;
 
+cv::Mat omnidirTest::randomImage() const
+{
+    cv::Mat image(imageSize, CV_8UC3);
+    cv::RNG r;
+    r.fill(image, cv::RNG::UNIFORM, 0, 256);
+    return image;
+}
+
+cv::Matx33d omnidirTest::longLatiCamera(const cv::Size& size)
+{
+    return cv::Matx33d(size.width / CV_PI, 0, 0,
+                       0, size.height / CV_PI, 0,
+                       0, 0, 1);
+}
+
 std::string omnidirTest::combine(const std::string& _item1, const std::string& _item2)
 {
     std::string item1 = _item1, item2 = _item2;